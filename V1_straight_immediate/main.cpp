@@ -14,24 +14,48 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cctype>
 #include <chrono>
+#include <climits>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
+/// Unsigned 128-bit integer; the search window uses it so engine=bpsw can go past 2^63
+using u128 = unsigned __int128;
+
 /**
  * @struct Config
  * @brief Configuration parameters for the prime finder
  */
 struct Config {
     int threads = 4;           
-    long long limit = 100000;  
+    u128 limit = 100000;
+    u128 lo = 2;               ///< Lower bound of the search window, inclusive (default: 2)
+    string engine = "sieve";   ///< Search engine: "sieve", "trial", "mr", "bpsw" or "auto" (default: sieve)
+    long long segment_kb = 0;  ///< Sieve segment size in KiB; <= 0 picks it from the cache sizes (default: 0)
+    string partition = "dynamic"; ///< "dynamic" (work stealing / claimed strips) or "static" (fixed cost-balanced chunks) (default: dynamic)
 };
 
 /**
@@ -60,15 +84,97 @@ inline string now_str() {
     return string(out);
 }
 
+/**
+ * @brief Parse a decimal integer that may not fit in 64 bits
+ * @param s Decimal digits, optionally preceded by whitespace
+ * @return The parsed value; negative input yields 0 so normalize_config() clamps it
+ * @throws invalid_argument if s does not start with a number
+ * @throws out_of_range if the value exceeds 2^128 - 1
+ */
+u128 parse_u128(const string& s) {
+    size_t i = s.find_first_not_of(" \t");
+    const bool negative = (i != string::npos && s[i] == '-');
+    if (negative) ++i;
+    if (i >= s.size() || !isdigit((unsigned char)s[i])) throw invalid_argument("parse_u128: " + s);
+    u128 v = 0;
+    for (; i < s.size() && isdigit((unsigned char)s[i]); ++i) {
+        const unsigned d = (unsigned)(s[i] - '0');
+        if (v > (~(u128)0 - d) / 10) throw out_of_range("parse_u128: " + s);
+        v = v * 10 + d;
+    }
+    return negative ? 0 : v;
+}
+
+/**
+ * @brief Format a 128-bit value in decimal
+ * @param v Value to format
+ * @return Decimal string (streams have no operator<< for unsigned __int128)
+ */
+string to_string_u128(u128 v) {
+    if ((v >> 64) == 0) return to_string((unsigned long long)v);
+    char buf[40];
+    char* p = buf + sizeof(buf);
+    *--p = '\0';
+    do { *--p = char('0' + (unsigned)(v % 10)); v /= 10; } while (v != 0);
+    return string(p);
+}
+
+/**
+ * @brief Apply a single key=value setting to a configuration
+ * @param c Configuration to update
+ * @param k Setting name
+ * @param v Setting value
+ * @return false if the key is not recognized
+ * 
+ * Shared by the config file and command-line parsers so both accept the same keys.
+ * "hi" is an alias for "limit".
+ */
+bool apply_setting(Config& c, const string& k, const string& v) {
+    if (k == "threads") c.threads = stoi(v);
+    else if (k == "limit" || k == "hi") c.limit = parse_u128(v);
+    else if (k == "lo") c.lo = parse_u128(v);
+    else if (k == "engine") c.engine = v;
+    else if (k == "segment_kb") c.segment_kb = stoll(v);
+    else if (k == "partition") c.partition = v;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief Clamp configuration values to sensible minimums
+ * @param c Configuration to validate in place
+ */
+void normalize_config(Config& c) {
+    if (c.threads <= 0) c.threads = max(1u, thread::hardware_concurrency());
+    if (c.limit < 2) c.limit = 2;
+    if (c.lo < 2) c.lo = 2;
+    if (c.engine != "sieve" && c.engine != "trial" && c.engine != "mr" && c.engine != "bpsw" && c.engine != "auto") {
+        cerr << "[WARN] Unknown engine '" << c.engine << "', using sieve.\n";
+        c.engine = "sieve";
+    }
+    if (c.limit > (u128)LLONG_MAX && c.engine != "bpsw" && c.engine != "auto") {
+        cerr << "[WARN] engine=" << c.engine << " stops at 2^63 - 1, using bpsw.\n";
+        c.engine = "bpsw";
+    }
+    if (c.partition != "dynamic" && c.partition != "static") {
+        cerr << "[WARN] Unknown partition '" << c.partition << "', using dynamic.\n";
+        c.partition = "dynamic";
+    }
+    if (c.limit >= c.lo && c.limit - c.lo > (u128)UINT64_MAX) {
+        cerr << "[WARN] Windows wider than 2^64 are not supported, using limit=lo+2^64-1.\n";
+        c.limit = c.lo + (u128)UINT64_MAX;
+    }
+}
+
 /**
  * @brief Load configuration from a text file
  * @param path Path to the configuration file (default: "config.txt")
  * @return Config object with loaded or default values
  * 
  * Reads a simple key=value format configuration file.
- * Lines starting with '#' are treated as comments.
+ * Lines starting with '#' are treated as comments, as is anything after a '#'.
  * If file cannot be opened or values are invalid, defaults are used.
- * Validates thread count and limit values, setting sensible minimums.
+ * Validates thread count and range values, setting sensible minimums.
  */
 Config load_config(const string& path = "config.txt") {
     Config c;
@@ -78,7 +184,7 @@ Config load_config(const string& path = "config.txt") {
         return c;
     }
     string line;
-
+    // Lambda to trim whitespace from both ends of a string
     auto trim = [](string s) {
         auto l = s.find_first_not_of(" \t\r\n");
         auto r = s.find_last_not_of(" \t\r\n");
@@ -86,44 +192,1589 @@ Config load_config(const string& path = "config.txt") {
         return s.substr(l, r - l + 1);
     };
     while (getline(in, line)) {
-        if (line.empty() || line[0] == '#') continue;
+        // Strip trailing comments so "key=value   # note" lines parse cleanly
+        auto hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        if (line.empty()) continue;
         auto eq = line.find('=');
         if (eq == string::npos) continue;
-        string k = trim(line.substr(0, eq));
-        string v = trim(line.substr(eq + 1));
-        if (k == "threads") c.threads = stoi(v);
-        else if (k == "limit") c.limit = stoll(v);
+        apply_setting(c, trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
     }
-    if (c.threads <= 0) c.threads = max(1u, thread::hardware_concurrency());
-    if (c.limit < 2) c.limit = 2;
+    normalize_config(c);
     return c;
 }
 
+/**
+ * @brief Override configuration values from command-line flags
+ * @param c Configuration loaded from the config file
+ * @param argc Argument count from main()
+ * @param argv Argument vector from main()
+ * 
+ * Accepts the same keys as the config file as "--key=value" (e.g. --lo=1000000
+ * --hi=2000000), so one config file can drive several interval shards.
+ */
+void apply_cli(Config& c, int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) arg = arg.substr(2);
+        auto eq = arg.find('=');
+        if (eq == string::npos || !apply_setting(c, arg.substr(0, eq), arg.substr(eq + 1))) {
+            cerr << "[WARN] Ignoring unknown option " << argv[i] << "\n";
+        }
+    }
+    normalize_config(c);
+}
+
+/**
+ * @struct TrialDivisor
+ * @brief An odd table prime with the constants for a multiply-only divisibility test
+ * 
+ * For odd p, n ↦ n·p^-1 mod 2^64 is a bijection that maps the multiples of p
+ * exactly onto [0, ⌊(2^64 - 1) / p⌋], so p | n ⇔ n·inv ≤ lim (Granlund–Montgomery).
+ * That is one multiply and one compare instead of a hardware division.
+ */
+struct TrialDivisor {
+    uint64_t inv;  ///< p^-1 mod 2^64
+    uint64_t lim;  ///< ⌊(2^64 - 1) / p⌋
+    uint32_t p;    ///< The prime itself
+
+    /// True if p divides n
+    inline bool divides(uint64_t n) const { return n * inv <= lim; }
+};
+
+/**
+ * @brief Precompute the divisibility constants for a table of primes
+ * @param primes Ascending primes, e.g. from sieving_primes(); 2 is skipped
+ * @return One TrialDivisor per odd prime, in the same order
+ */
+vector<TrialDivisor> make_trial_divisors(const vector<uint32_t>& primes) {
+    vector<TrialDivisor> out;
+    out.reserve(primes.size());
+    for (uint32_t p : primes) {
+        if (p == 2) continue;
+        uint64_t inv = p;  // Correct to 3 bits for odd p; each Newton step doubles that
+        for (int i = 0; i < 5; ++i) inv *= 2 - (uint64_t)p * inv;
+        out.push_back(TrialDivisor{inv, ~0ULL / p, p});
+    }
+    return out;
+}
+
 /**
  * @brief Test if a number is prime using trial division
  * @param n The number to test for primality
+ * @param divisors Odd primes up to at least √n (see make_trial_divisors())
  * @return true if n is prime, false otherwise
  * 
- * Uses optimized trial division with special cases for 2 and 3,
- * then checks divisibility by numbers of form 6k±1 up to √n.
- * This optimization is based on the fact that all primes > 3 are of form 6k±1.
+ * Tries only the primes up to √n. Stepping through 6k±1 instead would also
+ * try composites such as 25 and 35, which is about 3x as many divisions for
+ * large n. Each test is a multiply and a compare (TrialDivisor::divides()).
  */
-inline bool is_prime_trial(long long n) {
+inline bool is_prime_trial(long long n, const vector<TrialDivisor>& divisors) {
     if (n < 2) return false;
     if (n % 2 == 0) return n == 2;
-    if (n % 3 == 0) return n == 3;
-    for (long long d = 5; d * d <= n; d += 6) {
-        if (n % d == 0 || n % (d + 2) == 0) return false;
+    for (const TrialDivisor& d : divisors) {
+        if ((long long)d.p * d.p > n) break;
+        if (d.divides((uint64_t)n)) return false;
     }
     return true;
 }
 
+/**
+ * @struct Montgomery64
+ * @brief Montgomery arithmetic modulo a fixed odd 64-bit modulus
+ * 
+ * Residues are kept in the form a·R mod n with R = 2^64, so a modular product
+ * becomes one 64×64→128 multiply plus a REDC step (two more multiplies and a
+ * subtraction) instead of a 128-by-64 division. The only divisions happen
+ * once, in the constructor, to compute R² mod n.
+ */
+struct Montgomery64 {
+    unsigned long long n;     ///< Odd modulus
+    unsigned long long ninv;  ///< n^-1 mod 2^64
+    unsigned long long r2;    ///< R² mod n, used to convert into Montgomery form
+    unsigned long long one;   ///< R mod n, i.e. 1 in Montgomery form
+
+    /**
+     * @brief Precompute the constants for modulus m
+     * @param m Odd modulus (> 1)
+     */
+    explicit Montgomery64(unsigned long long m) : n(m) {
+        ninv = m;  // Correct to 3 bits for odd m; each Newton step doubles that
+        for (int i = 0; i < 5; ++i) ninv *= 2 - m * ninv;
+        one = (0 - m) % m;
+        r2 = one >= m - one ? one - (m - one) : one + one;  // 2·R mod n
+        for (int i = 0; i < 6; ++i) r2 = mul(r2, r2);       // Squaring 2^k·R gives 2^2k·R; avoids a 128-bit remainder
+    }
+
+    /**
+     * @brief Montgomery reduction: t·R^-1 mod n
+     * @param t Value below n·R
+     * @return Reduced value in [0, n)
+     * 
+     * Subtracts q·n with q = t·n^-1 mod R, so the low 64 bits cancel exactly
+     * and only the high halves need to be compared.
+     */
+    inline unsigned long long reduce(unsigned __int128 t) const {
+        unsigned long long q = (unsigned long long)t * ninv;
+        unsigned long long qn_hi = (unsigned long long)(((unsigned __int128)q * n) >> 64);
+        unsigned long long t_hi = (unsigned long long)(t >> 64);
+        return t_hi >= qn_hi ? t_hi - qn_hi : t_hi - qn_hi + n;
+    }
+
+    /// Convert a (< n) into Montgomery form
+    inline unsigned long long to_mont(unsigned long long a) const { return reduce((unsigned __int128)a * r2); }
+    /// Convert a Montgomery-form residue back to an ordinary one
+    inline unsigned long long from_mont(unsigned long long a) const { return reduce(a); }
+    /// Product of two Montgomery-form residues
+    inline unsigned long long mul(unsigned long long a, unsigned long long b) const {
+        return reduce((unsigned __int128)a * b);
+    }
+
+    /**
+     * @brief Binary exponentiation in Montgomery form
+     * @param a Base in Montgomery form
+     * @param e Exponent
+     * @return a^e in Montgomery form
+     */
+    inline unsigned long long pow(unsigned long long a, unsigned long long e) const {
+        unsigned long long result = one;
+        for (; e > 0; e >>= 1) {
+            if (e & 1) result = mul(result, a);
+            a = mul(a, a);
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Test if a number is prime using deterministic Miller–Rabin
+ * @param n The number to test for primality
+ * @return true if n is prime, false otherwise
+ * 
+ * Small primes up to 37 are handled by division, then n - 1 = d·2^s is tested
+ * as a strong probable prime to the 7 bases 2, 325, 9375, 28178, 450775,
+ * 9780504 and 1795265022, which has no 64-bit counterexamples (Sinclair).
+ * Cost is O(log n) Montgomery multiplications instead of O(√n) divisions.
+ */
+inline bool is_prime_mr(long long n) {
+    if (n < 2) return false;
+    for (long long p : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        if (n % p == 0) return n == p;
+    }
+    if (n < 41 * 41) return true;
+    const unsigned long long m = (unsigned long long)n;
+    const Montgomery64 mont(m);
+    const unsigned long long minus_one = m - mont.one;  // -1 in Montgomery form
+    unsigned long long d = m - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    for (unsigned long long a : {2ULL, 325ULL, 9375ULL, 28178ULL, 450775ULL, 9780504ULL, 1795265022ULL}) {
+        a %= m;
+        if (a == 0) continue;  // Base is a multiple of n: no information
+        unsigned long long x = mont.pow(mont.to_mont(a), d);
+        if (x == mont.one || x == minus_one) continue;
+        bool witness = true;
+        for (int r = 1; r < s && witness; ++r) {
+            x = mont.mul(x, x);
+            if (x == minus_one) witness = false;
+        }
+        if (witness) return false;
+    }
+    return true;
+}
+
+/**
+ * @struct Montgomery32
+ * @brief Montgomery arithmetic modulo a fixed odd 32-bit modulus (R = 2^32)
+ * 
+ * The 32-bit counterpart of Montgomery64: products fit in 64 bits, so REDC
+ * needs no 128-bit arithmetic at all.
+ */
+struct Montgomery32 {
+    uint32_t n;     ///< Odd modulus
+    uint32_t ninv;  ///< n^-1 mod 2^32
+    uint32_t r2;    ///< R² mod n, used to convert into Montgomery form
+    uint32_t one;   ///< R mod n, i.e. 1 in Montgomery form
+
+    /**
+     * @brief Precompute the constants for modulus m
+     * @param m Odd modulus (> 1)
+     */
+    explicit Montgomery32(uint32_t m) : n(m) {
+        ninv = m;  // Correct to 3 bits for odd m; each Newton step doubles that
+        for (int i = 0; i < 4; ++i) ninv *= 2 - m * ninv;
+        one = (uint32_t)((1ULL << 32) % m);
+        r2 = (uint32_t)((uint64_t)one * one % m);
+    }
+
+    /// Montgomery reduction of t < n·R: t·R^-1 mod n
+    inline uint32_t reduce(uint64_t t) const {
+        const uint32_t qn_hi = (uint32_t)(((uint64_t)((uint32_t)t * ninv) * n) >> 32);
+        const uint32_t t_hi = (uint32_t)(t >> 32);
+        return t_hi >= qn_hi ? t_hi - qn_hi : t_hi - qn_hi + n;
+    }
+    /// Product of two Montgomery-form residues
+    inline uint32_t mul(uint32_t a, uint32_t b) const { return reduce((uint64_t)a * b); }
+    /// Convert a (< n) into Montgomery form
+    inline uint32_t to_mont(uint32_t a) const { return mul(a, r2); }
+
+    /**
+     * @brief Binary exponentiation in Montgomery form
+     * @param a Base in Montgomery form
+     * @param e Exponent
+     * @return a^e in Montgomery form
+     */
+    inline uint32_t pow(uint32_t a, uint32_t e) const {
+        uint32_t result = one;
+        for (; e > 0; e >>= 1) {
+            if (e & 1) result = mul(result, a);
+            a = mul(a, a);
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Bucket of n in kMr32Bases
+ * @param n Candidate below 2^32
+ * @return Index in [0, 256)
+ */
+inline uint32_t hash_mr32(uint32_t n) {
+    uint32_t h = n;
+    h = ((h >> 16) ^ h) * 0x45d9f3bu;
+    h = ((h >> 16) ^ h) * 0x45d9f3bu;
+    return ((h >> 16) ^ h) & 255;
+}
+
+/**
+ * @brief One Miller–Rabin base per hash bucket, for is_prime_mr32()
+ * 
+ * Found by exhaustive search (Forišek–Jančina): for every odd composite
+ * n < 2^32 not divisible by 3, 5 or 7, kMr32Bases[hash_mr32(n)] is a strong
+ * witness. No base has a prime factor above 7 in its own bucket, so a base is
+ * never a multiple of a prime that uses it.
+ */
+constexpr uint32_t kMr32Bases[256] = {
+    17456, 327, 3361, 11428, 505, 2656, 1720, 7046, 6337, 808, 8261, 2857, 5205, 3088, 38, 23091,
+    6562, 30649, 7561, 3202, 1254, 6756, 6830, 15438, 3905, 1325, 590, 4579, 4804, 12562, 176, 3871,
+    3520, 386, 434, 842, 19291, 6839, 493, 376, 6116, 3251, 3194, 746, 1924, 626, 11073, 3602,
+    11633, 3926, 111, 1016, 16576, 2383, 26471, 9697, 489, 1589, 476, 15, 2752, 13394, 370, 3109,
+    8342, 129, 2917, 1827, 1691, 4605, 12638, 154, 462, 113, 1895, 586, 4646, 5506, 1353, 6425,
+    71, 52, 2248, 917, 1309, 212, 2688, 10676, 6895, 5835, 4831, 10984, 2859, 4272, 429, 4782,
+    6943, 2442, 1242, 581, 2068, 146, 3339, 15063, 1221, 1920, 1865, 6940, 4770, 3649, 265, 1028,
+    2799, 13146, 366, 7327, 3674, 6563, 2165, 1031, 1144, 1113, 5372, 1101, 230, 898, 3749, 554,
+    764, 2749, 2642, 16593, 1230, 7739, 5332, 1082, 2869, 1606, 6779, 1760, 439, 1337, 2647, 1948,
+    433, 3208, 3044, 541, 1929, 942, 708, 1978, 2509, 1996, 2634, 1011, 1090, 2948, 532, 1039,
+    251, 1072, 1224, 1307, 309, 18597, 2485, 7887, 4122, 309, 6422, 2038, 7726, 37343, 2697, 18814,
+    18239, 6237, 11327, 133, 14413, 11318, 11016, 1788, 526, 2871, 6842, 11499, 4492, 4728, 1461, 1386,
+    9890, 27987, 1030, 895, 1328, 16286, 5778, 7445, 9947, 2668, 12496, 11826, 1459, 9922, 4570, 8718,
+    2049, 19017, 1012, 5241, 1349, 7236, 629, 68597, 2198, 5482, 8931, 1281, 4849, 9372, 2923, 177,
+    2994, 1249, 3980, 1352, 6234, 6434, 1042, 1476, 16399, 16825, 5983, 1807, 1302, 377, 5178, 70,
+    911, 589, 3248, 1098, 8268, 2664, 1318, 2906, 1054, 6453, 89, 2804, 322, 5552, 10790, 222
+};
+
+/**
+ * @brief Test if a 32-bit number is prime using a single hashed Miller–Rabin base
+ * @param n The number to test for primality
+ * @return true if n is prime, false otherwise
+ * 
+ * After division by 2, 3, 5 and 7, one strong probable-prime test to the base
+ * kMr32Bases[hash_mr32(n)] is exact for every n < 2^32: a single modular
+ * exponentiation of about 32 Montgomery products.
+ */
+inline bool is_prime_mr32(uint32_t n) {
+    if (n < 2) return false;
+    for (uint32_t p : {2u, 3u, 5u, 7u}) {
+        if (n % p == 0) return n == p;
+    }
+    if (n < 11 * 11) return true;
+    const Montgomery32 mont(n);
+    const uint32_t minus_one = n - mont.one;
+    uint32_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    uint32_t x = mont.pow(mont.to_mont(kMr32Bases[hash_mr32(n)] % n), d);
+    if (x == mont.one || x == minus_one) return true;
+    for (int r = 1; r < s; ++r) {
+        x = mont.mul(x, x);
+        if (x == minus_one) return true;
+    }
+    return false;
+}
+
+/**
+ * @struct Mr32Batch
+ * @brief Eight candidates below 2^32 laid out for the batched Miller–Rabin kernels
+ * 
+ * Each lane holds its own modulus, Montgomery constants and hashed base, widened
+ * to 64 bits so an AVX2 register carries 4 lanes and an AVX-512 register 8.
+ * mr32_prepare() fills the per-lane constants; a kernel then writes prime[].
+ */
+struct Mr32Batch {
+    static constexpr int kLanes = 8;
+    alignas(64) uint64_t n[kLanes];      ///< Odd modulus per lane
+    alignas(64) uint64_t ninv[kLanes];   ///< n^-1 mod 2^32
+    alignas(64) uint64_t one[kLanes];    ///< 1 in Montgomery form
+    alignas(64) uint64_t base[kLanes];   ///< Hashed base in Montgomery form
+    alignas(64) uint64_t d[kLanes];      ///< Odd part of n - 1
+    alignas(64) uint64_t s[kLanes];      ///< n - 1 = d·2^s
+    uint8_t prime[kLanes];               ///< Kernel result: strong probable prime to base
+};
+
+/**
+ * @brief Fill one lane of a batch with the constants for candidate n
+ * @param b Batch to fill
+ * @param lane Lane index
+ * @param n Odd candidate >= 121 not divisible by 3, 5 or 7
+ */
+inline void mr32_prepare(Mr32Batch& b, int lane, uint32_t n) {
+    const Montgomery32 mont(n);
+    uint32_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    b.n[lane] = n;
+    b.ninv[lane] = mont.ninv;
+    b.one[lane] = mont.one;
+    b.base[lane] = mont.to_mont(kMr32Bases[hash_mr32(n)] % n);
+    b.d[lane] = d;
+    b.s[lane] = (uint64_t)s;
+}
+
+/**
+ * @brief Portable batched kernel: one scalar is_prime_mr32() call per lane
+ * @param b Prepared batch; prime[] receives the results
+ */
+inline void mr32_kernel_scalar(Mr32Batch& b) {
+    for (int i = 0; i < Mr32Batch::kLanes; ++i) b.prime[i] = is_prime_mr32((uint32_t)b.n[i]);
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+/// Montgomery product in 4 lanes; inputs and result are 32-bit values in 64-bit lanes
+__attribute__((target("avx2"))) inline __m256i mont_mul_avx2(__m256i a, __m256i b, __m256i n, __m256i ninv) {
+    const __m256i t = _mm256_mul_epu32(a, b);
+    const __m256i qn = _mm256_mul_epu32(_mm256_mul_epu32(t, ninv), n);  // mul_epu32 reads the low 32 bits: q = t·ninv mod 2^32
+    const __m256i t_hi = _mm256_srli_epi64(t, 32);
+    const __m256i qn_hi = _mm256_srli_epi64(qn, 32);
+    const __m256i borrow = _mm256_cmpgt_epi64(qn_hi, t_hi);
+    return _mm256_add_epi64(_mm256_sub_epi64(t_hi, qn_hi), _mm256_and_si256(borrow, n));
+}
+
+/**
+ * @brief AVX2 batched kernel: two interleaved groups of 4 lanes
+ * @param b Prepared batch; prime[] receives the results
+ * 
+ * Lanes run the same right-to-left exponentiation; a lane whose exponent bit is
+ * clear keeps its old product through a blend, so all lanes step together for
+ * as many bits as the longest exponent. The two groups are independent chains,
+ * which hides the multiply latency.
+ */
+__attribute__((target("avx2"))) inline void mr32_kernel_avx2(Mr32Batch& b) {
+    const __m256i ones = _mm256_set1_epi64x(1);
+    __m256i n[2], ninv[2], one[2], minus_one[2], x[2], a[2], e[2], s[2], prime[2];
+    uint64_t dmax = 0, smax = 0;
+    for (int g = 0; g < 2; ++g) {
+        n[g] = _mm256_load_si256((const __m256i*)(b.n + 4 * g));
+        ninv[g] = _mm256_load_si256((const __m256i*)(b.ninv + 4 * g));
+        one[g] = _mm256_load_si256((const __m256i*)(b.one + 4 * g));
+        minus_one[g] = _mm256_sub_epi64(n[g], one[g]);
+        a[g] = _mm256_load_si256((const __m256i*)(b.base + 4 * g));
+        e[g] = _mm256_load_si256((const __m256i*)(b.d + 4 * g));
+        s[g] = _mm256_load_si256((const __m256i*)(b.s + 4 * g));
+        x[g] = one[g];
+    }
+    for (int i = 0; i < Mr32Batch::kLanes; ++i) { dmax |= b.d[i]; smax = max(smax, b.s[i]); }
+    for (; dmax != 0; dmax >>= 1) {
+        for (int g = 0; g < 2; ++g) {
+            const __m256i bit = _mm256_cmpeq_epi64(_mm256_and_si256(e[g], ones), ones);
+            x[g] = _mm256_blendv_epi8(x[g], mont_mul_avx2(x[g], a[g], n[g], ninv[g]), bit);
+            a[g] = mont_mul_avx2(a[g], a[g], n[g], ninv[g]);
+            e[g] = _mm256_srli_epi64(e[g], 1);
+        }
+    }
+    for (int g = 0; g < 2; ++g) {
+        prime[g] = _mm256_or_si256(_mm256_cmpeq_epi64(x[g], one[g]), _mm256_cmpeq_epi64(x[g], minus_one[g]));
+    }
+    for (uint64_t r = 1; r < smax; ++r) {
+        const __m256i rv = _mm256_set1_epi64x((long long)r);
+        for (int g = 0; g < 2; ++g) {
+            x[g] = mont_mul_avx2(x[g], x[g], n[g], ninv[g]);
+            const __m256i live = _mm256_cmpgt_epi64(s[g], rv);  // Only the first s - 1 squarings count
+            prime[g] = _mm256_or_si256(prime[g], _mm256_and_si256(live, _mm256_cmpeq_epi64(x[g], minus_one[g])));
+        }
+    }
+    for (int g = 0; g < 2; ++g) {
+        const int m = _mm256_movemask_pd(_mm256_castsi256_pd(prime[g]));
+        for (int i = 0; i < 4; ++i) b.prime[4 * g + i] = (m >> i) & 1;
+    }
+}
+
+/// Montgomery product in 8 lanes; inputs and result are 32-bit values in 64-bit lanes
+__attribute__((target("avx512f"))) inline __m512i mont_mul_avx512(__m512i a, __m512i b, __m512i n, __m512i ninv) {
+    const __m512i t = _mm512_mul_epu32(a, b);
+    const __m512i qn = _mm512_mul_epu32(_mm512_mul_epu32(t, ninv), n);
+    const __m512i t_hi = _mm512_srli_epi64(t, 32);
+    const __m512i qn_hi = _mm512_srli_epi64(qn, 32);
+    const __m512i diff = _mm512_sub_epi64(t_hi, qn_hi);
+    return _mm512_mask_add_epi64(diff, _mm512_cmpgt_epu64_mask(qn_hi, t_hi), diff, n);
+}
+
+/**
+ * @brief AVX-512 batched kernel: all 8 lanes in one register, masks instead of blends
+ * @param b Prepared batch; prime[] receives the results
+ */
+__attribute__((target("avx512f"))) inline void mr32_kernel_avx512(Mr32Batch& b) {
+    const __m512i n = _mm512_load_si512(b.n);
+    const __m512i ninv = _mm512_load_si512(b.ninv);
+    const __m512i one = _mm512_load_si512(b.one);
+    const __m512i minus_one = _mm512_sub_epi64(n, one);
+    const __m512i s = _mm512_load_si512(b.s);
+    const __m512i ones = _mm512_set1_epi64(1);
+    __m512i a = _mm512_load_si512(b.base);
+    __m512i e = _mm512_load_si512(b.d);
+    __m512i x = one;
+    uint64_t dmax = 0, smax = 0;
+    for (int i = 0; i < Mr32Batch::kLanes; ++i) { dmax |= b.d[i]; smax = max(smax, b.s[i]); }
+    for (; dmax != 0; dmax >>= 1) {
+        const __mmask8 bit = _mm512_test_epi64_mask(e, ones);
+        x = _mm512_mask_mov_epi64(x, bit, mont_mul_avx512(x, a, n, ninv));
+        a = mont_mul_avx512(a, a, n, ninv);
+        e = _mm512_srli_epi64(e, 1);
+    }
+    __mmask8 prime = _mm512_cmpeq_epu64_mask(x, one) | _mm512_cmpeq_epu64_mask(x, minus_one);
+    for (uint64_t r = 1; r < smax; ++r) {
+        x = mont_mul_avx512(x, x, n, ninv);
+        const __mmask8 live = _mm512_cmpgt_epu64_mask(s, _mm512_set1_epi64((long long)r));
+        prime |= live & _mm512_cmpeq_epu64_mask(x, minus_one);
+    }
+    for (int i = 0; i < Mr32Batch::kLanes; ++i) b.prime[i] = (prime >> i) & 1;
+}
+#endif
+
+/// Batched strong-test kernel; all variants produce identical results
+using Mr32Kernel = void (*)(Mr32Batch&);
+
+/**
+ * @brief Pick the widest batched kernel the CPU supports
+ * @return AVX-512, AVX2 or scalar kernel
+ */
+inline Mr32Kernel select_mr32_kernel() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return mr32_kernel_avx512;
+    if (__builtin_cpu_supports("avx2")) return mr32_kernel_avx2;
+#endif
+    return mr32_kernel_scalar;
+}
+
+/**
+ * @brief Report every prime in [a, b] using the batched 32-bit Miller–Rabin kernels
+ * @param a Start of the range (inclusive)
+ * @param b End of the range (inclusive, < 2^32)
+ * @param emit Callback invoked as emit(uint32_t prime), in increasing order
+ * 
+ * Numbers below 121 are decided by is_prime_mr32(). Above that, multiples of
+ * 2, 3, 5 and 7 are skipped and the survivors are collected eight at a time
+ * and tested with one hashed base each.
+ */
+template <class Emit>
+void for_each_prime_mr32(uint32_t a, uint32_t b, Emit emit) {
+    static const Mr32Kernel kernel = select_mr32_kernel();
+    Mr32Batch batch;
+    int lanes = 0;
+    auto flush = [&]() {
+        if (lanes == 0) return;
+        for (int i = lanes; i < Mr32Batch::kLanes; ++i) mr32_prepare(batch, i, 121);  // Pad with a composite
+        kernel(batch);
+        for (int i = 0; i < lanes; ++i) {
+            if (batch.prime[i]) emit((uint32_t)batch.n[i]);
+        }
+        lanes = 0;
+    };
+    for (uint64_t n = a; n <= b; ++n) {  // 64-bit counter: b may be UINT32_MAX
+        if (n < 121) {
+            if (is_prime_mr32((uint32_t)n)) emit((uint32_t)n);  // Batch is still empty here
+            continue;
+        }
+        if (n % 2 == 0 || n % 3 == 0 || n % 5 == 0 || n % 7 == 0) continue;
+        mr32_prepare(batch, lanes, (uint32_t)n);
+        if (++lanes == Mr32Batch::kLanes) flush();
+    }
+    flush();
+}
+
+/**
+ * @brief Full 128×128→256-bit product
+ * @param a First factor
+ * @param b Second factor
+ * @param hi Receives the upper 128 bits
+ * @return The lower 128 bits
+ */
+inline u128 mul_wide_u128(u128 a, u128 b, u128& hi) {
+    const u128 a0 = (uint64_t)a, a1 = a >> 64, b0 = (uint64_t)b, b1 = b >> 64;
+    const u128 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    const u128 mid = (p00 >> 64) + (uint64_t)p01 + (uint64_t)p10;  // < 3·2^64, cannot overflow
+    hi = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+    return (mid << 64) | (uint64_t)p00;
+}
+
+/**
+ * @struct Montgomery128
+ * @brief Montgomery arithmetic modulo a fixed odd 128-bit modulus (R = 2^128)
+ * 
+ * The 128-bit counterpart of Montgomery64: a product is one 256-bit multiply
+ * built from four 64×64 multiplies plus a REDC step, with no 256-by-128 division.
+ */
+struct Montgomery128 {
+    u128 n;     ///< Odd modulus
+    u128 ninv;  ///< n^-1 mod 2^128
+    u128 r2;    ///< R² mod n, used to convert into Montgomery form
+    u128 one;   ///< R mod n, i.e. 1 in Montgomery form
+
+    /**
+     * @brief Precompute the constants for modulus m
+     * @param m Odd modulus (> 1)
+     */
+    explicit Montgomery128(u128 m) : n(m) {
+        ninv = m;  // Correct to 3 bits for odd m; each Newton step doubles that
+        for (int i = 0; i < 6; ++i) ninv *= 2 - m * ninv;
+        one = (0 - m) % m;
+        r2 = one;
+        for (int i = 0; i < 128; ++i) r2 = add(r2, r2);  // Doubling avoids a 256-bit remainder
+    }
+
+    /**
+     * @brief Montgomery reduction: (hi·R + lo)·R^-1 mod n
+     * @param hi Upper half of a value below n·R (so hi < n)
+     * @param lo Lower half
+     * @return Reduced value in [0, n)
+     */
+    inline u128 reduce(u128 hi, u128 lo) const {
+        u128 qn_hi;
+        mul_wide_u128(lo * ninv, n, qn_hi);
+        return hi >= qn_hi ? hi - qn_hi : hi - qn_hi + n;
+    }
+
+    /// Sum of two residues mod n
+    inline u128 add(u128 a, u128 b) const { return a >= n - b ? a - (n - b) : a + b; }
+    /// Difference of two residues mod n
+    inline u128 sub(u128 a, u128 b) const { return a >= b ? a - b : a + (n - b); }
+    /// Product of two Montgomery-form residues
+    inline u128 mul(u128 a, u128 b) const {
+        u128 hi;
+        const u128 lo = mul_wide_u128(a, b, hi);
+        return reduce(hi, lo);
+    }
+    /// Convert a (< n) into Montgomery form
+    inline u128 to_mont(u128 a) const { return mul(a, r2); }
+
+    /**
+     * @brief Binary exponentiation in Montgomery form
+     * @param a Base in Montgomery form
+     * @param e Exponent
+     * @return a^e in Montgomery form
+     */
+    inline u128 pow(u128 a, u128 e) const {
+        u128 result = one;
+        for (; e > 0; e >>= 1) {
+            if (e & 1) result = mul(result, a);
+            a = mul(a, a);
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Integer square root of a 128-bit value
+ * @param n Input value
+ * @return floor(√n)
+ */
+inline u128 isqrt_u128(u128 n) {
+    const u128 cap = ~0ULL;  // floor(√(2^128 - 1))
+    u128 r = (u128)sqrtl((long double)n);
+    if (r > cap) r = cap;
+    // long double may be as narrow as double, so step the estimate onto the exact root
+    if (r > 0) r = min(cap, (r + n / r) / 2);
+    while (r * r > n) --r;
+    while (r < cap && (r + 1) * (r + 1) <= n) ++r;
+    return r;
+}
+
+/**
+ * @brief Jacobi symbol (a/n)
+ * @param a Numerator
+ * @param n Odd positive denominator
+ * @return -1, 0 or 1
+ */
+inline int jacobi_u128(u128 a, u128 n) {
+    int t = 1;
+    a %= n;
+    while (a != 0) {
+        while ((a & 1) == 0) {
+            a >>= 1;
+            const unsigned r = (unsigned)(n & 7);
+            if (r == 3 || r == 5) t = -t;
+        }
+        swap(a, n);
+        if ((a & 3) == 3 && (n & 3) == 3) t = -t;
+        a %= n;
+    }
+    return (n == 1) ? t : 0;
+}
+
+/**
+ * @brief Strong Lucas probable-prime test with Selfridge parameters
+ * @param n Odd candidate above 2^63 with no small factors
+ * @param mont Montgomery context for n
+ * @return true if n is a strong Lucas probable prime
+ * 
+ * Picks the first D in 5, -7, 9, -11, ... with (D/n) = -1 and uses P = 1,
+ * Q = (1 - D) / 4. With n + 1 = d·2^s, n passes if U_d ≡ 0 or V_{d·2^r} ≡ 0
+ * for some 0 ≤ r < s. Only the V sequence is computed: U_d ≡ 0 exactly when
+ * 2·V_{d+1} ≡ P·V_d, since D·U_k = 2·V_{k+1} - P·V_k and gcd(D, n) = 1.
+ */
+inline bool is_strong_lucas_prp(u128 n, const Montgomery128& mont) {
+    // A perfect square has no D with (D/n) = -1, so the search would never end
+    const u128 root = isqrt_u128(n);
+    if (root * root == n) return false;
+    long long D = 5;
+    for (;; D = (D > 0) ? -(D + 2) : -D + 2) {
+        const int j = jacobi_u128((D > 0) ? (u128)D : n - (u128)(-D), n);
+        if (j == -1) break;
+        if (j == 0) return false;  // |D| < n shares a factor with n
+    }
+    const long long Q = (1 - D) / 4;
+    const u128 q = mont.to_mont((Q >= 0) ? (u128)Q : n - (u128)(-Q));
+    const u128 two = mont.add(mont.one, mont.one);
+
+    u128 d = n + 1;  // n is odd and not 2^128 - 1 (a multiple of 3), so this cannot wrap
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+
+    // Ladder over the bits of d keeping (V_k, V_{k+1}, Q^k), starting at k = 0
+    u128 vk = two, vk1 = mont.one, qk = mont.one;
+    const int top = (d >> 64) ? 127 - __builtin_clzll((uint64_t)(d >> 64)) : 63 - __builtin_clzll((uint64_t)d);
+    for (int bit = top; bit >= 0; --bit) {
+        const u128 cross = mont.sub(mont.mul(vk, vk1), qk);  // V_{2k+1} = V_k·V_{k+1} - P·Q^k
+        if ((d >> bit) & 1) {
+            const u128 qk1 = mont.mul(qk, q);
+            vk = cross;
+            vk1 = mont.sub(mont.mul(vk1, vk1), mont.add(qk1, qk1));  // V_{2k+2} = V_{k+1}² - 2·Q^{k+1}
+            qk = mont.mul(qk, qk1);
+        } else {
+            vk1 = cross;
+            vk = mont.sub(mont.mul(vk, vk), mont.add(qk, qk));  // V_{2k} = V_k² - 2·Q^k
+            qk = mont.mul(qk, qk);
+        }
+    }
+    if (mont.add(vk1, vk1) == vk || vk == 0) return true;
+    for (int r = 1; r < s; ++r) {
+        vk = mont.sub(mont.mul(vk, vk), mont.add(qk, qk));
+        if (vk == 0) return true;
+        qk = mont.mul(qk, qk);
+    }
+    return false;
+}
+
+/**
+ * @brief Test if a number is prime using the Baillie–PSW test
+ * @param n The number to test for primality
+ * @return true if n is prime (or a BPSW pseudoprime, none of which is known)
+ * 
+ * Values below 2^63 go to the deterministic is_prime_mr(). Larger ones are
+ * trial-divided by the primes up to 53, then must pass a strong base-2
+ * Miller–Rabin round and a strong Lucas test, both in 128-bit Montgomery form.
+ */
+inline bool is_prime_bpsw(u128 n) {
+    if ((n >> 63) == 0) return is_prime_mr((long long)n);
+    for (unsigned p : {2u, 3u, 5u, 7u, 11u, 13u, 17u, 19u, 23u, 29u, 31u, 37u, 41u, 43u, 47u, 53u}) {
+        if (n % p == 0) return false;  // n > 2^63, so it cannot be p itself
+    }
+    const Montgomery128 mont(n);
+    const u128 minus_one = n - mont.one;
+    u128 d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    u128 x = mont.pow(mont.to_mont(2), d);
+    if (x != mont.one && x != minus_one) {
+        bool witness = true;
+        for (int r = 1; r < s && witness; ++r) {
+            x = mont.mul(x, x);
+            if (x == minus_one) witness = false;
+        }
+        if (witness) return false;
+    }
+    return is_strong_lucas_prp(n, mont);
+}
+
+/// Fallback sieve window size when the cache topology cannot be detected (32 KiB)
+constexpr long long kSegmentBytes = 1LL << 15;
+/// Largest window accepted; BucketSieve packs window offsets into 26 bits
+constexpr long long kMaxSegmentBytes = 1LL << 25;
+
+/**
+ * @struct CacheInfo
+ * @brief Per-core data cache capacities in bytes (0 when unknown)
+ */
+struct CacheInfo {
+    long long l1d = 0;
+    long long l2 = 0;
+};
+
+/**
+ * @brief Detect the L1d and L2 capacity available to one core
+ * @return Detected sizes; fields stay 0 when the platform does not report them
+ * 
+ * On Linux, reads /sys/devices/system/cpu/cpu0/cache/index* and divides shared
+ * caches by the number of CPUs sharing them, so each worker's segment fits its
+ * own share. Falls back to sysconf() where available and sysctl on macOS.
+ */
+CacheInfo detect_cache_sizes() {
+    CacheInfo info;
+#if defined(__linux__)
+    // Count CPUs in a list like "0-3,8-11"
+    auto count_cpus = [](const string& list) {
+        long long n = 0;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t comma = list.find(',', pos);
+            if (comma == string::npos) comma = list.size();
+            const string part = list.substr(pos, comma - pos);
+            const size_t dash = part.find('-');
+            if (!part.empty()) n += (dash == string::npos) ? 1 : stoll(part.substr(dash + 1)) - stoll(part.substr(0, dash)) + 1;
+            pos = comma + 1;
+        }
+        return max(1LL, n);
+    };
+    for (int idx = 0; idx < 8; ++idx) {
+        const string dir = "/sys/devices/system/cpu/cpu0/cache/index" + to_string(idx) + "/";
+        ifstream level_in(dir + "level"), type_in(dir + "type"), size_in(dir + "size"), shared_in(dir + "shared_cpu_list");
+        int level = 0;
+        string type, size, shared;
+        if (!(level_in >> level) || !(type_in >> type) || !(size_in >> size)) continue;
+        if (type == "Instruction" || size.empty()) continue;
+        long long bytes = stoll(size);
+        const char unit = size.back();
+        if (unit == 'K') bytes <<= 10;
+        else if (unit == 'M') bytes <<= 20;
+        if (shared_in >> shared) bytes /= count_cpus(shared);
+        if (level == 1) info.l1d = bytes;
+        else if (level == 2) info.l2 = bytes;
+    }
+#endif
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    if (info.l1d <= 0) info.l1d = max(0L, sysconf(_SC_LEVEL1_DCACHE_SIZE));
+    if (info.l2 <= 0) info.l2 = max(0L, sysconf(_SC_LEVEL2_CACHE_SIZE));
+#endif
+#if defined(__APPLE__)
+    auto sysctl_size = [](const char* name) {
+        int64_t v = 0;
+        size_t len = sizeof(v);
+        return (sysctlbyname(name, &v, &len, nullptr, 0) == 0) ? (long long)v : 0LL;
+    };
+    if (info.l1d <= 0) info.l1d = sysctl_size("hw.l1dcachesize");
+    if (info.l2 <= 0) info.l2 = sysctl_size("hw.l2cachesize");
+#endif
+    return info;
+}
+
+/**
+ * @brief Pick the sieve window size for one worker thread
+ * @param override_kb Configured segment size in KiB (<= 0 means automatic)
+ * @param cache Per-core cache capacities
+ * @return Window size in bytes, a multiple of 64 within [4 KiB, kMaxSegmentBytes]
+ * 
+ * The window plus the per-prime crossing state and the pre-sieve slice being
+ * copied should stay cache resident, so the automatic choice is a quarter of
+ * the per-core L2 share, or the full L1d when no L2 is reported, or
+ * kSegmentBytes when nothing is known.
+ */
+long long choose_segment_bytes(long long override_kb, const CacheInfo& cache) {
+    long long bytes = kSegmentBytes;
+    if (override_kb > 0) bytes = override_kb << 10;
+    else if (cache.l2 > 0) bytes = cache.l2 / 4;
+    else if (cache.l1d > 0) bytes = cache.l1d;
+    bytes = min(kMaxSegmentBytes, max(4096LL, bytes));
+    return bytes / 64 * 64;
+}
+
+/**
+ * @brief Integer square root
+ * @param n Non-negative value
+ * @return floor(√n), corrected for floating-point rounding
+ */
+inline long long isqrt_ll(long long n) {
+    long long r = (long long)sqrt((long double)n);
+    while (r > 0 && r > n / r) --r;           // r*r > n, without overflow
+    while (r + 1 <= n / (r + 1)) ++r;         // (r+1)² <= n, without overflow
+    return r;
+}
+
+/**
+ * @brief Generate the sieving primes up to √limit
+ * @param limit Upper bound of the whole search range
+ * @return All primes p with p*p <= limit, in ascending order
+ * 
+ * Runs a segmented odd-only Sieve of Eratosthenes over [0, √limit], so even
+ * limit=1e18 (primes up to 1e9) needs only one small segment plus the output.
+ * Every such prime fits in 32 bits. The table is built once in main() and
+ * shared read-only by every worker thread.
+ */
+vector<uint32_t> sieving_primes(long long limit) {
+    const long long r = isqrt_ll(limit);
+    vector<uint32_t> primes;
+    if (r < 2) return primes;
+    primes.reserve((size_t)(r / max(1.0, log((double)r) - 1.1)) + 16);
+    primes.push_back(2);
+
+    // Odd base primes up to √r, then odd numbers [lo, lo + 2*len) per segment
+    const long long rr = isqrt_ll(r);
+    vector<char> small_composite((size_t)rr + 1, 0);
+    vector<long long> base;
+    for (long long i = 3; i <= rr; i += 2) {
+        if (small_composite[i]) continue;
+        base.push_back(i);
+        for (long long j = i * i; j <= rr; j += 2 * i) small_composite[j] = 1;
+    }
+    const long long len = kSegmentBytes;  // Odd numbers per segment
+    vector<char> seg((size_t)len);
+    vector<long long> next(base.size());
+    for (size_t i = 0; i < base.size(); ++i) next[i] = base[i] * base[i];
+    for (long long lo = 3; lo <= r; lo += 2 * len) {
+        const long long hi = min(r, lo + 2 * len - 1);
+        memset(seg.data(), 1, (size_t)len);
+        for (size_t i = 0; i < base.size(); ++i) {
+            long long m = next[i];
+            for (; m <= hi; m += 2 * base[i]) seg[(m - lo) / 2] = 0;
+            next[i] = m;
+        }
+        for (long long n = lo; n <= hi; n += 2) {
+            if (seg[(n - lo) / 2]) primes.push_back((uint32_t)n);
+        }
+    }
+    return primes;
+}
+
+/// Residues modulo 30 coprime to 30; bit k of a wheel byte represents 30*i + kWheel[k]
+constexpr int kWheel[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+/// Distance from kWheel[k] to the next residue coprime to 30
+constexpr int kWheelGap[8] = {6, 4, 2, 4, 2, 4, 6, 2};
+
+/**
+ * @struct WheelTables
+ * @brief Crossing-off tables for the mod-30 wheel layout
+ * 
+ * For a sieving prime p = 30k + kWheel[c], the multiple p*q with q ≡ kWheel[j]
+ * (mod 30) lives in bit bit[c][j] of its byte. Stepping q to the next residue
+ * coprime to 30 advances the byte index by k*kWheelGap[j] + corr[c][j].
+ */
+struct WheelTables {
+    int8_t bit_of[30];   ///< Bit index of each residue mod 30, -1 if not coprime to 30
+    uint8_t mask[8][8];  ///< AND-mask clearing bit[c][j]
+    uint8_t corr[8][8];  ///< Byte-step correction from the residue product carry
+    constexpr WheelTables() : bit_of{}, mask{}, corr{} {
+        for (int r = 0; r < 30; ++r) bit_of[r] = -1;
+        for (int k = 0; k < 8; ++k) bit_of[kWheel[k]] = (int8_t)k;
+        for (int c = 0; c < 8; ++c) {
+            for (int j = 0; j < 8; ++j) {
+                const int w = kWheel[j];
+                const int w_next = w + kWheelGap[j];
+                mask[c][j] = (uint8_t)~(1u << bit_of[(kWheel[c] * w) % 30]);
+                corr[c][j] = (uint8_t)((kWheel[c] * w_next) / 30 - (kWheel[c] * w) / 30);
+            }
+        }
+    }
+};
+constexpr WheelTables kWheelTables{};
+
+/**
+ * @struct WheelPrime
+ * @brief Crossing-off state of one sieving prime p = 30k + kWheel[c]
+ * 
+ * next is the byte index (relative to the bitmap) of the next multiple p*q to
+ * cross off, and j is the wheel index of q mod 30.
+ */
+struct WheelPrime {
+    long long k;
+    int c;
+    long long next;
+    int j;
+};
+
+/**
+ * @brief Build the crossing-off state for prime p starting at the first multiple >= start
+ * @param p Sieving prime (>= 7)
+ * @param start Smallest number that may be crossed off (>= p²)
+ * @param base_byte Wheel byte index that the state's byte offsets are relative to
+ */
+inline WheelPrime make_wheel_prime(long long p, long long start, long long base_byte) {
+    const long long q = start / p + (start % p != 0);
+    int j = 0;
+    while (kWheel[j] < q % 30) ++j;  // kWheel[7] = 29 bounds every residue
+    // p*q may exceed LLONG_MAX near the top of the range, only its byte index matters
+    const __int128 m = (__int128)p * (q / 30 * 30 + kWheel[j]);
+    return WheelPrime{p / 30, kWheelTables.bit_of[p % 30], (long long)(m / 30) - base_byte, j};
+}
+
+/**
+ * @brief Cross off the multiples of one sieving prime up to a byte bound
+ * @param bytes Wheel bitmap storage
+ * @param end Byte index (exclusive) at which to stop
+ * @param wp Crossing state, advanced in place so the next window resumes from it
+ */
+inline void cross_off(uint8_t* bytes, long long end, WheelPrime& wp) {
+    long long i = wp.next;
+    int j = wp.j;
+    const uint8_t (&mask)[8] = kWheelTables.mask[wp.c];
+    const uint8_t (&corr)[8] = kWheelTables.corr[wp.c];
+    while (i < end) {
+        bytes[i] &= mask[j];
+        i += wp.k * kWheelGap[j] + corr[j];
+        j = (j + 1) & 7;
+    }
+    wp.next = i;
+    wp.j = j;
+}
+
+/**
+ * @class BucketSieve
+ * @brief Bucket sieve for large sieving primes (Oliveira e Silva)
+ * 
+ * A prime whose byte step exceeds the window size hits a window at most once,
+ * so scanning every such prime for every window would mostly find nothing.
+ * Instead, each large prime sits in the bucket list of the window holding its
+ * next multiple. Processing a window crosses off exactly the entries in its
+ * list and re-files each prime under the window of its following multiple.
+ * Buckets are fixed-size blocks recycled through a free list, so memory stays
+ * proportional to the number of large primes rather than to the number of hits.
+ */
+class BucketSieve {
+public:
+    /**
+     * @param total_bytes Size of the bitmap in wheel bytes
+     * @param window_bytes Bytes per window (must be below 2^26)
+     */
+    BucketSieve(long long total_bytes, long long window_bytes)
+        : heads_((size_t)((total_bytes + window_bytes - 1) / window_bytes), nullptr),
+          total_bytes_(total_bytes), window_bytes_(window_bytes) {}
+
+    /// @return true if a prime with wheel step k = p/30 never hits one window twice
+    static bool is_large(long long k, long long window_bytes) { return 2 * k >= window_bytes; }
+
+    /// File a prime's crossing state under the window holding its next multiple
+    void add(const WheelPrime& wp) {
+        if (wp.next >= total_bytes_) return;  // No multiple left inside the range
+        const long long w = wp.next / window_bytes_;
+        const uint32_t off = (uint32_t)(wp.next - w * window_bytes_);
+        push(w, Entry{(uint32_t)wp.k, (off << 6) | ((uint32_t)wp.c << 3) | (uint32_t)wp.j});
+    }
+
+    /**
+     * @brief Cross off every large-prime multiple that falls into window w
+     * @param w Window index
+     * @param bytes Wheel bitmap storage (the whole bitmap, not just the window)
+     */
+    void sieve_window(long long w, uint8_t* bytes) {
+        Bucket* bucket = heads_[(size_t)w];
+        heads_[(size_t)w] = nullptr;
+        uint8_t* win = bytes + w * window_bytes_;
+        const long long end = min(window_bytes_, total_bytes_ - w * window_bytes_);
+        while (bucket != nullptr) {
+            for (uint32_t e = 0; e < bucket->count; ++e) {
+                const Entry en = bucket->entries[e];
+                const int c = (int)(en.packed >> 3) & 7;
+                int j = (int)en.packed & 7;
+                long long i = en.packed >> 6;
+                while (i < end) {
+                    win[i] &= kWheelTables.mask[c][j];
+                    i += (long long)en.k * kWheelGap[j] + kWheelTables.corr[c][j];
+                    j = (j + 1) & 7;
+                }
+                add(WheelPrime{en.k, c, w * window_bytes_ + i, j});
+            }
+            Bucket* next = bucket->next;
+            bucket->next = free_;
+            free_ = bucket;
+            bucket = next;
+        }
+    }
+
+private:
+    /// One large prime: k = p/30, plus (window offset << 6 | residue class << 3 | wheel index)
+    struct Entry {
+        uint32_t k;
+        uint32_t packed;
+    };
+    static constexpr uint32_t kBucketEntries = 1024;
+    struct Bucket {
+        Entry entries[kBucketEntries];
+        uint32_t count = 0;
+        Bucket* next = nullptr;
+    };
+
+    void push(long long w, Entry e) {
+        Bucket*& head = heads_[(size_t)w];
+        if (head == nullptr || head->count == kBucketEntries) {
+            Bucket* fresh = free_;
+            if (fresh != nullptr) {
+                free_ = fresh->next;
+            } else {
+                pool_.emplace_back(new Bucket());
+                fresh = pool_.back().get();
+            }
+            fresh->count = 0;
+            fresh->next = head;
+            head = fresh;
+        }
+        head->entries[head->count++] = e;
+    }
+
+    vector<Bucket*> heads_;              ///< Bucket list per window
+    vector<unique_ptr<Bucket>> pool_;    ///< Owns every bucket ever allocated
+    Bucket* free_ = nullptr;             ///< Recycled buckets
+    long long total_bytes_;
+    long long window_bytes_;
+};
+
+/// Primes whose multiples are pre-sieved into the periodic segment pattern
+constexpr long long kPresievePrimes[5] = {7, 11, 13, 17, 19};
+
+/**
+ * @brief Build the pre-sieved wheel pattern for kPresievePrimes
+ * @return 7·11·13·17·19 = 323323 wheel bytes with every multiple of those primes cleared
+ * 
+ * Because 30 is coprime to each pre-sieved prime, the wheel bytes of
+ * [0, 30·323323) repeat with that period. Every segment starts as a copy of the
+ * matching slice of this pattern, so only primes above 19 cross off per segment.
+ */
+vector<uint8_t> build_presieve_pattern() {
+    long long period = 1;
+    for (long long p : kPresievePrimes) period *= p;
+    vector<uint8_t> pattern((size_t)period, 0xff);
+    for (long long p : kPresievePrimes) {
+        WheelPrime wp = make_wheel_prime(p, p, 0);
+        cross_off(pattern.data(), period, wp);
+    }
+    return pattern;
+}
+
+/**
+ * @struct SieveContext
+ * @brief Read-only tables shared by every sieve worker, built once in main()
+ */
+struct SieveContext {
+    vector<uint32_t> primes;   ///< Sieving primes up to √limit
+    vector<uint8_t> presieve;  ///< Periodic pattern with kPresievePrimes crossed off
+    long long segment_bytes = kSegmentBytes;  ///< Window size per worker, from choose_segment_bytes()
+};
+
+/**
+ * @class WheelBitmap
+ * @brief Bit-packed set of primes in [lo, hi] in the modulo-30 wheel layout
+ * 
+ * Byte i covers the 30 integers [30i, 30i + 30); its 8 bits represent the
+ * residues in kWheel, the only ones that can be prime above 5. The wheel primes
+ * 2, 3 and 5 are tracked by separate flags. Bytes are stored in 64-bit words so
+ * counting uses word-level popcount and enumeration uses count-trailing-zeros,
+ * neither of which needs a materialized vector of primes.
+ */
+class WheelBitmap {
+public:
+    /**
+     * @brief Cover [lo, hi]; the storage is zeroed until init_window() fills it
+     * @param lo Start of the range (inclusive)
+     * @param hi End of the range (inclusive)
+     */
+    void reset(long long lo, long long hi) {
+        small_.clear();
+        for (long long p : {2LL, 3LL, 5LL}) {
+            if (lo <= p && p <= hi) small_.push_back(p);
+        }
+        lo_ = max(1LL, lo);
+        hi_ = hi;
+        base_ = lo_ / 30;
+        bytes_ = (hi_ >= lo_) ? hi_ / 30 - base_ + 1 : 0;
+        words_.assign((size_t)((bytes_ + 7) / 8), 0);
+    }
+
+    /**
+     * @brief Initialize bytes [w0, w1) as sieve candidates before crossing off
+     * @param w0 First byte of the window (inclusive)
+     * @param w1 Last byte of the window (exclusive)
+     * @param pattern Pre-sieved pattern indexed by absolute wheel byte modulo its size
+     * 
+     * The window is copied from the periodic pattern, so multiples of the
+     * pre-sieved primes are already cleared. The pre-sieved primes themselves,
+     * the number 1 and the residues outside [lo, hi] are then fixed up.
+     */
+    void init_window(long long w0, long long w1, const vector<uint8_t>& pattern) {
+        uint8_t* b = bytes();
+        const long long period = (long long)pattern.size();
+        long long off = (base_ + w0) % period;
+        for (long long i = w0; i < w1; off = 0) {
+            const long long n = min(w1 - i, period - off);
+            memcpy(b + i, pattern.data() + off, (size_t)n);
+            i += n;
+        }
+        for (long long p : kPresievePrimes) {
+            const long long i = p / 30 - base_;
+            if (lo_ <= p && p <= hi_ && w0 <= i && i < w1) b[i] |= (uint8_t)(1u << kWheelTables.bit_of[p % 30]);
+        }
+        if (w0 == 0 && base_ == 0) b[0] &= (uint8_t)~1u;  // 1 is not prime
+        // Compared as offsets within the edge bytes: the last byte's residues may exceed LLONG_MAX
+        for (int k = 0; k < 8; ++k) {
+            if (w0 == 0 && kWheel[k] < lo_ - base_ * 30) b[0] &= (uint8_t)~(1u << k);
+            if (w1 == bytes_ && kWheel[k] > hi_ - (base_ + bytes_ - 1) * 30) b[bytes_ - 1] &= (uint8_t)~(1u << k);
+        }
+    }
+
+    long long base_byte() const { return base_; }   ///< Wheel byte index of bytes()[0]
+    long long byte_count() const { return bytes_; }  ///< Number of wheel bytes covered
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(words_.data()); }  ///< Raw storage for sieving
+
+    /// @return Number of primes in the set
+    size_t count() const {
+        size_t total = small_.size();
+        for (uint64_t w : words_) total += (size_t)__builtin_popcountll(w);
+        return total;
+    }
+
+    /**
+     * @brief Visit every prime in the set in ascending order
+     * @param f Callback invoked as f(long long prime)
+     */
+    template <class F>
+    void for_each(F&& f) const {
+        for (long long p : small_) f(p);
+        for (size_t wi = 0; wi < words_.size(); ++wi) {
+            for (uint64_t w = word_le(wi); w != 0; w &= w - 1) {
+                const int bit = __builtin_ctzll(w);
+                f((base_ + (long long)wi * 8 + bit / 8) * 30 + kWheel[bit % 8]);
+            }
+        }
+    }
+
+private:
+    /// Word wi with byte 0 in the low bits, independent of host byte order
+    uint64_t word_le(size_t wi) const {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_bswap64(words_[wi]);
+#else
+        return words_[wi];
+#endif
+    }
+
+    vector<uint64_t> words_;
+    vector<long long> small_;
+    long long lo_ = 1;
+    long long hi_ = 0;
+    long long base_ = 0;
+    long long bytes_ = 0;
+};
+
+/**
+ * @brief Find all primes in [a, b] with a segmented Sieve of Eratosthenes
+ * @param a Start of the range (inclusive)
+ * @param b End of the range (inclusive)
+ * @param ctx Shared sieving primes (covering at least √b) and pre-sieve pattern
+ * @param out Receives the primes of [a, b] as a mod-30 wheel bitmap
+ * 
+ * The bitmap is sieved in place, one window of ctx.segment_bytes at a time. Each
+ * window starts as a copy of the pre-sieve pattern; every remaining sieving
+ * prime p > 19 then crosses off only the multiples p*q with q coprime to 30,
+ * starting at max(p², a), so numbers below p² (including p itself) survive.
+ * The per-prime state carries over between windows, so the first multiple is
+ * computed once per chunk. Primes too large to hit a window more than once go
+ * through a BucketSieve, so each window only touches the primes that hit it.
+ */
+void sieve_range(long long a, long long b, const SieveContext& ctx, WheelBitmap& out) {
+    out.reset(max(2LL, a), b);
+    const long long nbytes = out.byte_count();
+    if (nbytes == 0) return;
+    uint8_t* bytes = out.bytes();
+
+    const long long seg = ctx.segment_bytes;
+    const long long windows = (nbytes + seg - 1) / seg;
+    vector<WheelPrime> state;
+    BucketSieve large(nbytes, seg);
+    for (uint32_t prime : ctx.primes) {
+        const long long p = prime;
+        if (p <= kPresievePrimes[4]) continue;
+        if (p * p > b) break;
+        const WheelPrime wp = make_wheel_prime(p, max(p * p, a), out.base_byte());
+        if (BucketSieve::is_large(wp.k, seg)) large.add(wp);
+        else state.push_back(wp);
+    }
+    for (long long w = 0; w < windows; ++w) {
+        const long long w0 = w * seg;
+        const long long w1 = min(nbytes, w0 + seg);
+        out.init_window(w0, w1, ctx.presieve);
+        for (auto& wp : state) cross_off(bytes, w1, wp);
+        large.sieve_window(w, bytes);
+    }
+}
+
+/**
+ * @brief Choose how many integers one dynamically claimed sieve strip covers
+ * @param span Width of the whole search range
+ * @param threads Number of worker threads
+ * @param ctx Shared sieve tables (segment size and sieving primes)
+ * @return Strip length in integers, a whole number of segments where possible
+ * 
+ * Aims for about 16 strips per thread so threads that finish early keep finding
+ * work. Each strip recomputes the first multiple of every sieving prime, so a
+ * strip spans at least ~4 segments per segment-worth of sieving primes, which
+ * keeps that setup small next to the sieving itself for windows near 1e18.
+ */
+long long choose_strip_length(long long span, int threads, const SieveContext& ctx) {
+    const long long seg_numbers = ctx.segment_bytes * 30;
+    long long segs = span / seg_numbers / (16LL * threads);
+    segs = max(segs, 4 * (long long)ctx.primes.size() / ctx.segment_bytes + 1);
+    long long strip = (segs > span / seg_numbers) ? span : segs * seg_numbers;
+    strip = min(strip, span / threads + 1);  // Every thread gets at least one strip
+    return max(1LL, strip);
+}
+
+/**
+ * @brief Estimated cost of one number near n, in nanoseconds on a typical core
+ * @param engine "trial", "sieve", "mr" or "bpsw"
+ * @param n Magnitude of the numbers being tested
+ * @param batch32 Whether mr/bpsw run the batched 32-bit kernels (window below 2^32)
+ * 
+ * Every engine pays about 300 ns to report each prime, and a fraction 1/ln n of
+ * the numbers are prime. On top of that:
+ * - trial: a prime costs π(√n) ≈ 2√n / ln n divisions and composites stop
+ *   early, giving about 30 + 3.4·√n / ln² n.
+ * - sieve: about 5 per number (crossing off, pre-sieved copy and scan).
+ * - mr, bpsw: about 20 per number in the SIMD batch, 140 otherwise. Most
+ *   candidates take one exponentiation whatever their size.
+ * The constants were fitted to runs from 10^6 to 10^12 and only their ratios
+ * matter.
+ */
+inline long double cost_density(const string& engine, long double n, bool batch32) {
+    n = max(n, 16.0L);
+    const long double ln = logl(n);
+    long double test = batch32 ? 20 : 140;
+    if (engine == "trial") test = 30 + 3.4L * sqrtl(n) / (ln * ln);
+    if (engine == "sieve") test = 5;
+    return test + 300 / ln;
+}
+
+/**
+ * @brief Split [lo, hi] into contiguous chunks of equal estimated work
+ * @param lo First number of the window
+ * @param hi Last number of the window (hi >= lo, hi - lo < 2^64)
+ * @param T Number of chunks wanted
+ * @param engine Engine whose cost_density() weights the split
+ * @return First number of each chunk, ascending; chunk i ends one before chunk
+ *         i + 1 starts and the last one ends at hi. There are min(T, hi - lo + 1)
+ *         chunks, none empty.
+ * 
+ * The cost is integrated with the trapezoid rule over 1024 equal steps of the
+ * window, and chunk i starts where the running total reaches i/T of the whole,
+ * interpolating linearly inside a step. The split depends only on the
+ * configuration, so every run hands each thread the same numbers.
+ */
+vector<u128> partition_by_cost(u128 lo, u128 hi, int T, const string& engine) {
+    const u128 span = hi - lo + 1;
+    const int k = (int)min<u128>((u128)max(1, T), span);
+    constexpr int kSteps = 1024;
+    const long double x0 = (long double)lo;
+    const long double width = (long double)span;
+    const bool batch32 = (engine == "mr" || engine == "bpsw") && hi <= UINT32_MAX;
+    vector<long double> cum(kSteps + 1, 0);
+    long double prev = cost_density(engine, x0, batch32);
+    for (int s = 1; s <= kSteps; ++s) {
+        const long double cur = cost_density(engine, x0 + width * s / kSteps, batch32);
+        cum[s] = cum[s - 1] + (prev + cur) / 2;
+        prev = cur;
+    }
+
+    vector<u128> starts((size_t)k);
+    starts[0] = lo;
+    u128 last = 0;  // Offset of the previous chunk's start
+    for (int i = 1; i < k; ++i) {
+        const long double target = cum[kSteps] * i / k;
+        const int s = (int)(lower_bound(cum.begin() + 1, cum.end(), target) - cum.begin());
+        const long double step = cum[s] - cum[s - 1];
+        const long double frac = (step > 0) ? (target - cum[s - 1]) / step : 0;
+        u128 off = (u128)(width * (s - 1 + frac) / kSteps);
+        off = max(off, last + 1);                  // Never empty...
+        off = min(off, span - (u128)(k - i));      // ...and leave at least one number per later chunk
+        starts[(size_t)i] = lo + off;
+        last = off;
+    }
+    return starts;
+}
+
+/// Sub-ranges at most this wide are tested as one piece instead of being split again
+constexpr uint64_t kStealGrain = 1024;
+
+/**
+ * @class RangeDeque
+ * @brief Chase–Lev work-stealing deque of sub-ranges, one per worker thread
+ * 
+ * The owner pushes and pops at the bottom; other threads steal from the top with
+ * a CAS on top_, which also settles the race for the last element. Ranges are
+ * stored as offsets from the start of the window in two relaxed atomics, so a
+ * thief that reads a slot while it is being reused only sees a value whose CAS
+ * then fails. The buffer never grows: each entry is at most half the size of the
+ * one above it (see run_partitioned()), so a deque holds at most 65
+ * ranges of a window narrower than 2^64.
+ */
+class RangeDeque {
+public:
+    /// Inclusive range of offsets from the start of the window
+    struct Range {
+        uint64_t a, b;
+    };
+
+    /// Owner only: add r at the bottom
+    void push(const Range& r) {
+        const int64_t b = bottom_.load(memory_order_relaxed);
+        Slot& s = slots_[b & (kCapacity - 1)];
+        s.a.store(r.a, memory_order_relaxed);
+        s.b.store(r.b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        bottom_.store(b + 1, memory_order_relaxed);
+    }
+
+    /// Owner only: take the most recently pushed range
+    bool pop(Range& r) {
+        const int64_t b = bottom_.load(memory_order_relaxed) - 1;
+        bottom_.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t t = top_.load(memory_order_relaxed);
+        if (t > b) {  // Empty
+            bottom_.store(b + 1, memory_order_relaxed);
+            return false;
+        }
+        load(b, r);
+        if (t < b) return true;
+        // Last element: a thief may be taking it at the same time
+        const bool won = top_.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+        bottom_.store(b + 1, memory_order_relaxed);
+        return won;
+    }
+
+    /// Any thread: take the oldest (largest) range
+    bool steal(Range& r) {
+        int64_t t = top_.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        const int64_t b = bottom_.load(memory_order_acquire);
+        if (t >= b) return false;
+        load(t, r);
+        return top_.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    }
+
+private:
+    static constexpr int64_t kCapacity = 128;
+
+    struct Slot {
+        atomic<uint64_t> a{0};
+        atomic<uint64_t> b{0};
+    };
+
+    void load(int64_t i, Range& r) const {
+        const Slot& s = slots_[i & (kCapacity - 1)];
+        r.a = s.a.load(memory_order_relaxed);
+        r.b = s.b.load(memory_order_relaxed);
+    }
+
+    alignas(64) atomic<int64_t> top_{0};     ///< Next range to steal; only ever increases
+    alignas(64) atomic<int64_t> bottom_{0};  ///< One past the owner's newest range
+    Slot slots_[kCapacity];
+};
+
+/**
+ * @brief Run work(idx, a, b) over consecutive chunks, one thread per chunk
+ * @param starts First number of each chunk, ascending (see partition_by_cost())
+ * @param hi Last number of the last chunk (hi - starts[0] < 2^64)
+ * @param steal false: each thread runs work() once on its own chunk. true: idle
+ *        threads steal from busy ones, as below
+ * @param work Callback for one sub-range [a, b]; idx is the thread running it
+ * @return Number of threads started
+ * 
+ * With stealing, each thread's deque starts with its chunk. A thread pops the
+ * bottom range of its own deque, pushes its upper half back until at most
+ * kStealGrain numbers remain, and runs work() on that piece. The largest pending
+ * piece is always at the top, so an idle thread stealing from the top of a random
+ * victim takes half of what that victim had left. A count of unfinished ranges
+ * tells idle threads when everything is done.
+ */
+template <class Work>
+int run_partitioned(const vector<u128>& starts, u128 hi, bool steal, Work work) {
+    const int workers = (int)starts.size();
+    auto chunk_end = [&](int i) { return (i + 1 < workers) ? starts[(size_t)i + 1] - 1 : hi; };
+    vector<thread> threads;
+    threads.reserve((size_t)workers);
+    if (!steal) {
+        for (int i = 0; i < workers; ++i) threads.emplace_back(work, i, starts[(size_t)i], chunk_end(i));
+        for (auto& th : threads) th.join();
+        return workers;
+    }
+
+    const u128 lo = starts[0];
+    unique_ptr<RangeDeque[]> deques(new RangeDeque[workers]);
+    for (int i = 0; i < workers; ++i) {
+        deques[i].push({(uint64_t)(starts[(size_t)i] - lo), (uint64_t)(chunk_end(i) - lo)});
+    }
+    atomic<long long> pending{workers};  // Ranges pushed but not yet finished
+
+    auto run = [&](int idx) {
+        RangeDeque& own = deques[idx];
+        uint64_t rng = 0x9e3779b97f4a7c15ULL * (uint64_t)(idx + 1);
+        RangeDeque::Range r;
+        while (pending.load(memory_order_acquire) > 0) {
+            bool got = own.pop(r);
+            if (!got && workers > 1) {
+                rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+                const int first = (int)(rng % (uint64_t)workers);
+                for (int k = 0; k < workers && !got; ++k) {
+                    const int victim = (first + k) % workers;
+                    if (victim != idx) got = deques[victim].steal(r);
+                }
+            }
+            if (!got) {
+                this_thread::yield();
+                continue;
+            }
+            while (r.b - r.a >= kStealGrain) {
+                const uint64_t mid = r.a + (r.b - r.a) / 2;
+                pending.fetch_add(1, memory_order_relaxed);
+                own.push({mid + 1, r.b});
+                r.b = mid;
+            }
+            work(idx, lo + r.a, lo + r.b);
+            pending.fetch_sub(1, memory_order_acq_rel);
+        }
+    };
+
+    for (int i = 0; i < workers; ++i) threads.emplace_back(run, i);
+    for (auto& th : threads) th.join();
+    return workers;
+}
+
+/**
+ * @brief Measure the wall-clock time of a callable
+ * @param f Work to time
+ * @return Elapsed seconds
+ */
+template <class F>
+double time_seconds(F f) {
+    const auto t0 = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+/**
+ * @struct EngineCosts
+ * @brief Estimated single-thread running time of each engine for one job, in seconds
+ */
+struct EngineCosts {
+    double sieve = 0;
+    double trial = 0;
+    double mr = 0;
+};
+
+/**
+ * @brief Estimate how long each engine would take on [lo, hi]
+ * @param lo Start of the window (>= 2)
+ * @param hi End of the window (< 2^63)
+ * @param segment_bytes Sieve window size from choose_segment_bytes()
+ * @return Per-engine estimates
+ * 
+ * A few milliseconds of micro-benchmarks calibrate the model:
+ * - mr: the top min(width, 1024) numbers of the job are tested with the path the
+ *   workers would use, and the time per number is scaled to the full width.
+ * - trial: the same sample, plus the time to build the divisor table. It is only
+ *   considered while hi <= 2^40; above that a Miller–Rabin test is always cheaper.
+ * - sieve: building the sieving primes costs c_table per unit of √hi, and each
+ *   integer costs c_number. Each sieving prime costs c_prime once to place, and
+ *   again in every window if it is below the bucket threshold (15 per window
+ *   byte); larger primes cost about c_prime per bucket hit instead. The
+ *   constants come from small sieves near 2^24 (almost no sieving primes) and
+ *   2^40 (82025 sieving primes).
+ */
+EngineCosts estimate_engine_costs(long long lo, long long hi, long long segment_bytes) {
+    EngineCosts est;
+    const double width = (double)(hi - lo + 1);
+    const long long sample_lo = hi - min(hi - lo, 1023LL);
+    const double sample = (double)(hi - sample_lo + 1);
+    volatile long long sink = 0;  // Keeps the sampled tests from being optimized away
+
+    double t = time_seconds([&] {
+        if (hi <= (long long)UINT32_MAX) {
+            for_each_prime_mr32((uint32_t)sample_lo, (uint32_t)hi, [&](uint32_t) { sink = sink + 1; });
+        } else {
+            for (long long n = sample_lo; n <= hi; ++n) sink = sink + is_prime_mr(n);
+        }
+    });
+    est.mr = t / sample * width;
+
+    est.trial = numeric_limits<double>::infinity();
+    if (hi <= (1LL << 40)) {
+        vector<TrialDivisor> divisors;
+        const double t_table = time_seconds([&] { divisors = make_trial_divisors(sieving_primes(hi)); });
+        t = time_seconds([&] {
+            for (long long n = sample_lo; n <= hi; ++n) sink = sink + is_prime_trial(n, divisors);
+        });
+        est.trial = t_table + t / sample * width;
+    }
+
+    const long long x_small = 1LL << 24, x_large = 1LL << 40;
+    const long long seg_numbers = segment_bytes * 30;
+    SieveContext ctx;
+    ctx.segment_bytes = segment_bytes;
+    const double t_presieve = time_seconds([&] { ctx.presieve = build_presieve_pattern(); });
+    const double c_table = time_seconds([&] { ctx.primes = sieving_primes(x_large); }) / sqrt((double)x_large);
+    WheelBitmap out;
+    const double t_small = time_seconds([&] { sieve_range(x_small, x_small + 2 * seg_numbers - 1, ctx, out); }) / 2;
+    const double t_large = time_seconds([&] { sieve_range(x_large, x_large + 2 * seg_numbers - 1, ctx, out); }) / 2;
+    const double c_number = t_small / (double)seg_numbers;
+    const double c_prime = max(0.0, t_large - t_small) / (double)ctx.primes.size();
+    auto pi = [](double x) { return x / log(max(x, 3.0)); };
+    const double root = sqrt((double)hi);
+    const double bucket_min = 15.0 * (double)segment_bytes;  // BucketSieve::is_large() threshold
+    const double windows = ceil(width / (double)seg_numbers);
+    const double bucket_hits = (root > bucket_min) ? width * 8 / 30 * log(log(root) / log(bucket_min)) : 0;
+    est.sieve = t_presieve + c_table * root + c_number * width
+              + c_prime * (pi(root) + windows * pi(min(root, bucket_min)) + bucket_hits);
+    return est;
+}
+
+/**
+ * @brief Resolve engine=auto to the engine with the lowest estimated cost
+ * @param lo Start of the window
+ * @param hi End of the window
+ * @param segment_bytes Sieve window size from choose_segment_bytes()
+ * @return "sieve", "trial", "mr" or "bpsw"
+ * 
+ * Windows past 2^63 can only use bpsw. Otherwise a wide, dense window favors the
+ * sieve, a narrow window of huge numbers favors mr, and a handful of small
+ * numbers favors trial division; the estimates are printed to stderr.
+ */
+string choose_engine_auto(u128 lo, u128 hi, long long segment_bytes) {
+    if (hi > (u128)LLONG_MAX) return "bpsw";
+    if (hi < lo) return "sieve";
+    const EngineCosts est = estimate_engine_costs((long long)lo, (long long)hi, segment_bytes);
+    string engine = "sieve";
+    double best = est.sieve;
+    if (est.trial < best) { engine = "trial"; best = est.trial; }
+    if (est.mr < best) { engine = "mr"; best = est.mr; }
+    cerr << "[AUTO] engine=" << engine << " estimates: sieve=" << est.sieve << "s trial=" << est.trial
+         << "s mr=" << est.mr << "s\n";
+    return engine;
+}
+
 /**
  * @brief Main entry point for the multi-threaded prime finder with immediate output
  * 
  * Algorithm:
- * 1. Load configuration (thread count and limit)
- * 2. Divide the range [2, limit] among worker threads
+ * 1. Load configuration (thread count and search window), then apply command-line overrides
+ * 2. Divide the range [lo, limit] among worker threads: contiguous chunks of equal
+ *    estimated cost that idle threads split and steal from busy ones (trial, mr, bpsw),
+ *    or strips claimed one at a time from an atomic cursor (sieve). partition=static
+ *    keeps every thread on its fixed cost-balanced chunk instead.
  * 3. Each thread finds primes in its assigned range and immediately prints them
  * 4. Uses mutex to ensure thread-safe printing without interleaved output
  * 5. Waits for all threads to complete
@@ -133,66 +1784,132 @@ inline bool is_prime_trial(long long n) {
  * 
  * @return 0 on successful completion
  */
-int main() {
+int main(int argc, char** argv) {
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
     Config cfg = load_config();
+    apply_cli(cfg, argc, argv);
     cout << "[START] " << now_str() << "\n";
+    if (cfg.engine == "auto") {
+        cfg.engine = choose_engine_auto(cfg.lo, cfg.limit, choose_segment_bytes(cfg.segment_kb, detect_cache_sizes()));
+    }
 
     // Define the search range [nmin, nmax]
-    const long long nmin = 2;
-    const long long nmax = cfg.limit;
+    const u128 nmin = cfg.lo;
+    const u128 nmax = cfg.limit;
     const int T = max(1, cfg.threads);
 
-    // Calculate how to divide the range among threads
-    const long long span = (nmax >= nmin) ? (nmax - nmin + 1) : 0;
-    const long long chunk = (T > 0) ? (span / T) : span;
-    const long long rem = (T > 0) ? (span % T) : 0;
+    // Width of the window; see partition_by_cost() and run_partitioned() for how it is split
+    const u128 span = (nmax >= nmin) ? (nmax - nmin + 1) : 0;
 
     // Mutex for thread-safe printing
     mutex print_mtx;
     vector<thread> threads;
     threads.reserve(T);
 
+    // Shared read-only sieve tables: sieving primes up to √limit, pre-sieve pattern, segment size
+    const bool use_sieve = (cfg.engine == "sieve");
+    SieveContext ctx;
+    if (use_sieve) {
+        ctx.primes = sieving_primes((long long)nmax);  // normalize_config() keeps sieve windows below 2^63
+        ctx.presieve = build_presieve_pattern();
+        ctx.segment_bytes = choose_segment_bytes(cfg.segment_kb, detect_cache_sizes());
+    }
+    // Trial divisors: every prime up to √limit, built before any worker starts and then only read
+    const vector<TrialDivisor> divisors =
+        (cfg.engine == "trial") ? make_trial_divisors(sieving_primes((long long)nmax)) : vector<TrialDivisor>();
+
     /**
      * @brief Worker lambda function for each thread
      * @param idx Thread index (worker ID for identification)
      * @param a Start of the range to search (inclusive)
      * @param b End of the range to search (inclusive)
      * 
-     * Each worker tests numbers in its assigned range. When a prime is found,
+     * Each worker tests numbers in its assigned range (trial division, Miller–Rabin or
+     * Baillie–PSW, depending on the engine). When a prime is found,
      * it acquires the print mutex and immediately outputs the prime with metadata:
      * - The prime number itself
      * - Worker ID
      * - Thread ID
      * - Timestamp of discovery
      */
-    auto worker = [&](int idx, long long a, long long b) {
-        for (long long n = a; n <= b; ++n) {
-            if (is_prime_trial(n)) {
-                lock_guard<mutex> lk(print_mtx);
-                cout << "[PRIME] n=" << n
-                     << " worker=" << idx
-                     << " tid=" << this_thread::get_id()
-                     << " ts=" << now_str() << "\n";
-            }
+    function<bool(u128)> is_prime = is_prime_bpsw;
+    if (cfg.engine == "trial") is_prime = [&divisors](u128 n) { return is_prime_trial((long long)n, divisors); };
+    if (cfg.engine == "mr") is_prime = [](u128 n) { return is_prime_mr((long long)n); };
+    // Below 2^32 a single hashed Miller–Rabin round is exact, so mr and bpsw both use the batched kernels
+    const bool batch32 = (cfg.engine != "trial" && nmax <= UINT32_MAX);
+    auto worker = [&](int idx, u128 a, u128 b) {
+        auto report = [&](u128 n) {
+            lock_guard<mutex> lk(print_mtx);
+            cout << "[PRIME] n=" << to_string_u128(n)
+                 << " worker=" << idx
+                 << " tid=" << this_thread::get_id()
+                 << " ts=" << now_str() << "\n";
+        };
+        if (batch32) {
+            for_each_prime_mr32((uint32_t)a, (uint32_t)b, report);
+            return;
+        }
+        for (u128 n = a; n <= b; ++n) {
+            if (is_prime(n)) report(n);
+            if (n == b) break;  // Keep ++n from overflowing when b is the largest u128
         }
     };
 
+    /**
+     * @brief Sieve worker lambda: claims strips from a shared cursor until none are left
+     * @param idx Thread index (worker ID for identification)
+     * 
+     * The cost of a strip grows with √n, so a fixed split leaves the thread with the
+     * top chunk running long after the others. Claiming strips dynamically keeps
+     * every thread busy until the end. A strip's primes are all discovered when its
+     * sieve completes, so they are printed together under one lock and one timestamp.
+     */
+    const long long strip = use_sieve ? choose_strip_length((long long)span, T, ctx) : 0;
+    const long long strips = use_sieve ? ((long long)span + strip - 1) / strip : 0;
+    atomic<long long> cursor{0};
+    auto sieve_strip = [&](int idx, long long a, long long b, WheelBitmap& found) {
+        sieve_range(a, b, ctx, found);
+        const string ts = now_str();
+        lock_guard<mutex> lk(print_mtx);
+        found.for_each([&](long long n) {
+            cout << "[PRIME] n=" << n
+                 << " worker=" << idx
+                 << " tid=" << this_thread::get_id()
+                 << " ts=" << ts << "\n";
+        });
+    };
+    auto sieve_worker = [&](int idx) {
+        WheelBitmap found;
+        for (long long s = cursor.fetch_add(1); s < strips; s = cursor.fetch_add(1)) {
+            const long long a = (long long)nmin + s * strip;
+            const long long b = ((long long)nmax - a < strip) ? (long long)nmax : a + strip - 1;
+            sieve_strip(idx, a, b, found);
+        }
+    };
+    // partition=static: each thread sieves its own fixed chunk, one strip at a time
+    auto sieve_chunk = [&](int idx, u128 a, u128 b) {
+        WheelBitmap found;
+        for (long long s = (long long)a;; s += strip) {
+            const long long e = ((long long)b - s < strip) ? (long long)b : s + strip - 1;
+            sieve_strip(idx, s, e, found);
+            if (e == (long long)b) break;
+        }
+    };
 
-    long long start = nmin;
-    for (int i = 0; i < T; ++i) {
-        long long len = chunk + (i < rem ? 1 : 0);
-        if (len <= 0) break;  
-        long long a = start;
-        long long b = a + len - 1;
-        start = b + 1;
-        threads.emplace_back(worker, i, a, b);
+    const bool dynamic = (cfg.partition == "dynamic");
+    if (use_sieve && dynamic) {
+        for (int i = 0; i < T && i < strips; ++i) threads.emplace_back(sieve_worker, i);
+        for (auto& th : threads) th.join();
+    } else if (use_sieve && span > 0) {
+        run_partitioned(partition_by_cost(nmin, nmax, T, "sieve"), nmax, false, sieve_chunk);
+    } else if (span > 0) {
+        // Chunks of equal estimated cost; with partition=dynamic idle threads then steal
+        // halves of busy threads' ranges
+        run_partitioned(partition_by_cost(nmin, nmax, T, cfg.engine), nmax, dynamic, worker);
     }
 
-    for (auto& th : threads) th.join();
-
     cout << "[END] " << now_str() << "\n";
     return 0;
 }
\ No newline at end of file
@@ -22,28 +22,60 @@
  * + Batch output avoids I/O interleaving
  * - Higher memory usage (stores all primes)
  * - Delayed feedback (no output until completion)
- * - High thread creation overhead (threads spawned per number)
+ * - Per-number synchronization overhead (a pool round for every candidate)
  */
 
 #include <algorithm>
 #include <atomic>
+#include <cctype>
 #include <chrono>
+#include <climits>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
 using namespace std;
 
+/// Unsigned 128-bit integer; the search window uses it so engine=bpsw can go past 2^63
+using u128 = unsigned __int128;
+
+/// Largest candidate batch; one bit per candidate in a 64-bit composite mask
+constexpr int kMaxBatch = 64;
+
 /**
  * @struct Config
  * @brief Configuration parameters for the prime finder
  */
 struct Config {
     int threads = 4;          
-    long long limit = 100000; 
+    u128 limit = 100000;
+    u128 lo = 2;               ///< Lower bound of the search window, inclusive (default: 2)
+    string engine = "divtest"; ///< "divtest" (parallel trial division per number), "sieve", "mr", "bpsw" or "factor" (default: divtest)
+    long long segment_kb = 0;  ///< Sieve segment size in KiB; <= 0 picks it from the cache sizes (default: 0)
+    long long fanout_min = 0;  ///< Smallest n divtest splits across threads; <= 0 measures it at startup (default: 0)
+    int batch = 1;             ///< Consecutive candidates per divtest round, 1..64 (default: 1)
+    string schedule = "stripe"; ///< Divisor split for divtest: "stripe" (interleaved) or "block" (contiguous) (default: stripe)
+    int poll = 16;             ///< Divisors tried between checks of the composite flag (default: 16)
+    bool bench = false;        ///< Time both divtest schedules over the window instead of listing primes (default: false)
 };
 
 /**
@@ -71,15 +103,99 @@ inline string now_str() {
     return string(out);
 }
 
+/**
+ * @brief Parse a decimal integer that may not fit in 64 bits
+ * @param s Decimal digits, optionally preceded by whitespace
+ * @return The parsed value; negative input yields 0 so normalize_config() clamps it
+ * @throws invalid_argument if s does not start with a number
+ * @throws out_of_range if the value exceeds 2^128 - 1
+ */
+u128 parse_u128(const string& s) {
+    size_t i = s.find_first_not_of(" \t");
+    const bool negative = (i != string::npos && s[i] == '-');
+    if (negative) ++i;
+    if (i >= s.size() || !isdigit((unsigned char)s[i])) throw invalid_argument("parse_u128: " + s);
+    u128 v = 0;
+    for (; i < s.size() && isdigit((unsigned char)s[i]); ++i) {
+        const unsigned d = (unsigned)(s[i] - '0');
+        if (v > (~(u128)0 - d) / 10) throw out_of_range("parse_u128: " + s);
+        v = v * 10 + d;
+    }
+    return negative ? 0 : v;
+}
+
+/**
+ * @brief Format a 128-bit value in decimal
+ * @param v Value to format
+ * @return Decimal string (streams have no operator<< for unsigned __int128)
+ */
+string to_string_u128(u128 v) {
+    if ((v >> 64) == 0) return to_string((unsigned long long)v);
+    char buf[40];
+    char* p = buf + sizeof(buf);
+    *--p = '\0';
+    do { *--p = char('0' + (unsigned)(v % 10)); v /= 10; } while (v != 0);
+    return string(p);
+}
+
+/**
+ * @brief Apply a single key=value setting to a configuration
+ * @param c Configuration to update
+ * @param k Setting name
+ * @param v Setting value
+ * @return false if the key is not recognized
+ * 
+ * Shared by the config file and command-line parsers so both accept the same keys.
+ * "hi" is an alias for "limit".
+ */
+bool apply_setting(Config& c, const string& k, const string& v) {
+    if (k == "threads") c.threads = stoi(v);
+    else if (k == "limit" || k == "hi") c.limit = parse_u128(v);
+    else if (k == "lo") c.lo = parse_u128(v);
+    else if (k == "engine") c.engine = v;
+    else if (k == "segment_kb") c.segment_kb = stoll(v);
+    else if (k == "fanout_min") c.fanout_min = stoll(v);
+    else if (k == "batch") c.batch = stoi(v);
+    else if (k == "schedule") c.schedule = v;
+    else if (k == "poll") c.poll = stoi(v);
+    else if (k == "bench") c.bench = (v == "1" || v == "true");
+    else return false;
+    return true;
+}
+
+/**
+ * @brief Clamp configuration values to sensible minimums
+ * @param c Configuration to validate in place
+ */
+void normalize_config(Config& c) {
+    if (c.threads <= 0) c.threads = max(1u, thread::hardware_concurrency());
+    if (c.limit < 2) c.limit = 2;
+    if (c.lo < 2) c.lo = 2;
+    c.batch = min(max(c.batch, 1), kMaxBatch);
+    c.poll = max(c.poll, 1);
+    if (c.schedule != "stripe" && c.schedule != "block") {
+        cerr << "[WARN] Unknown schedule '" << c.schedule << "', using stripe.\n";
+        c.schedule = "stripe";
+    }
+    if (c.engine != "divtest" && c.engine != "sieve" && c.engine != "mr" && c.engine != "bpsw" && c.engine != "factor") {
+        cerr << "[WARN] Unknown engine '" << c.engine << "', using divtest.\n";
+        c.engine = "divtest";
+    }
+    if (c.limit > (u128)LLONG_MAX && c.engine != "bpsw") {
+        cerr << "[WARN] engine=" << c.engine << " stops at 2^63 - 1, using bpsw.\n";
+        c.engine = "bpsw";
+    }
+}
+
 /**
  * @brief Load configuration from a text file
  * @param path Path to the configuration file (default: "config.txt")
  * @return Config object with loaded or default values
  * 
  * Reads a simple key=value format configuration file.
- * Lines starting with '#' are treated as comments.
+ * Lines starting with '#' are treated as comments, as is anything after a '#'.
  * If file cannot be opened or values are invalid, defaults are used.
- * Validates thread count and limit values, setting sensible minimums.
+ * Validates thread count and range values, setting sensible minimums.
  */
 Config load_config(const string& path = "config.txt") {
     Config c;
@@ -89,6 +205,7 @@ Config load_config(const string& path = "config.txt") {
         return c;
     }
     string line;
+    // Lambda to trim whitespace from both ends of a string
     auto trim = [](string s) {
         auto l = s.find_first_not_of(" \t\r\n");
         auto r = s.find_last_not_of(" \t\r\n");
@@ -96,74 +213,1394 @@ Config load_config(const string& path = "config.txt") {
         return s.substr(l, r - l + 1);
     };
     while (getline(in, line)) {
-        if (line.empty() || line[0] == '#') continue;
+        // Strip trailing comments so "key=value   # note" lines parse cleanly
+        auto hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        if (line.empty()) continue;
         auto eq = line.find('=');
         if (eq == string::npos) continue;
-        string k = trim(line.substr(0, eq));
-        string v = trim(line.substr(eq + 1));
-        if (k == "threads") c.threads = stoi(v);
-        else if (k == "limit") c.limit = stoll(v);
+        apply_setting(c, trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
     }
-    if (c.threads <= 0) c.threads = max(1u, thread::hardware_concurrency());
-    if (c.limit < 2) c.limit = 2;
+    normalize_config(c);
     return c;
 }
 
+/**
+ * @brief Override configuration values from command-line flags
+ * @param c Configuration loaded from the config file
+ * @param argc Argument count from main()
+ * @param argv Argument vector from main()
+ * 
+ * Accepts the same keys as the config file as "--key=value" (e.g. --lo=1000000
+ * --hi=2000000), so one config file can drive several interval shards.
+ */
+void apply_cli(Config& c, int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) arg = arg.substr(2);
+        auto eq = arg.find('=');
+        if (eq == string::npos || !apply_setting(c, arg.substr(0, eq), arg.substr(eq + 1))) {
+            cerr << "[WARN] Ignoring unknown option " << argv[i] << "\n";
+        }
+    }
+    normalize_config(c);
+}
+
+/**
+ * @struct TrialDivisor
+ * @brief An odd table prime with the constants for a multiply-only divisibility test
+ * 
+ * For odd p, n ↦ n·p^-1 mod 2^64 is a bijection that maps the multiples of p
+ * exactly onto [0, ⌊(2^64 - 1) / p⌋], so p | n ⇔ n·inv ≤ lim (Granlund–Montgomery).
+ * That is one multiply and one compare instead of a hardware division.
+ */
+struct TrialDivisor {
+    uint64_t inv;  ///< p^-1 mod 2^64
+    uint64_t lim;  ///< ⌊(2^64 - 1) / p⌋
+    uint32_t p;    ///< The prime itself
+
+    /// True if p divides n
+    inline bool divides(uint64_t n) const { return n * inv <= lim; }
+};
+
+/**
+ * @brief Precompute the divisibility constants for a table of primes
+ * @param primes Ascending primes, e.g. from sieving_primes(); 2 is skipped
+ * @return One TrialDivisor per odd prime, in the same order
+ */
+vector<TrialDivisor> make_trial_divisors(const vector<uint32_t>& primes) {
+    vector<TrialDivisor> out;
+    out.reserve(primes.size());
+    for (uint32_t p : primes) {
+        if (p == 2) continue;
+        uint64_t inv = p;  // Correct to 3 bits for odd p; each Newton step doubles that
+        for (int i = 0; i < 5; ++i) inv *= 2 - (uint64_t)p * inv;
+        out.push_back(TrialDivisor{inv, ~0ULL / p, p});
+    }
+    return out;
+}
+
+/// Polls of a hot wait before the waiter parks on the futex (a few microseconds)
+constexpr int kSpinIterations = 4096;
+
+/// Tell the core we are busy-waiting (PAUSE on x86, YIELD on ARM)
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * @brief Sleep until word changes from expected or a wake arrives
+ * 
+ * C++17 has no atomic::wait, so on Linux this calls the futex syscall directly;
+ * it returns at once if word no longer equals expected, so a wake cannot be
+ * lost between the caller's check and the sleep. Spurious returns are allowed,
+ * callers re-check in a loop. Elsewhere it falls back to yielding.
+ */
+inline void futex_wait(atomic<uint32_t>& word, uint32_t expected) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    if (word.load(memory_order_acquire) == expected) this_thread::yield();
+#endif
+}
+
+/// Wake every thread sleeping in futex_wait() on word
+inline void futex_wake_all(atomic<uint32_t>& word) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+/**
+ * @class WorkerPool
+ * @brief T - 1 long-lived threads plus the caller, running one job per round
+ * 
+ * run(job) calls job(idx) once for every idx in [0, T): index 0 on the calling
+ * thread and the rest on the pool threads, and returns when all of them have
+ * finished. The threads are created once in main() and persist between rounds.
+ * 
+ * A round is an epoch barrier with two atomics on separate cache lines:
+ * - The caller publishes the job and bumps epoch_; workers wait for the bump.
+ * - Each worker decrements pending_ when done; the caller waits for zero.
+ * Both waits spin for kSpinIterations polls before parking on a futex, so
+ * back-to-back rounds never enter the kernel, and the wake syscall is only made
+ * when someone is actually parked. Spinning is disabled when the pool has more
+ * threads than the machine has hardware threads, since a spinner would then
+ * steal the core of the thread it is waiting for.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(int T)
+        : size_(max(1, T)), spin_((unsigned)size_ <= thread::hardware_concurrency() ? kSpinIterations : 0) {
+        threads_.reserve((size_t)(size_ - 1));
+        for (int i = 1; i < size_; ++i) threads_.emplace_back([this, i] { loop(i); });
+    }
+
+    ~WorkerPool() {
+        stop_ = true;
+        start_round();
+        for (auto& th : threads_) th.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// Number of participants in each round, including the caller
+    int size() const { return size_; }
+
+    /// Run job(idx) for idx = 0..size()-1 and wait for all of them to return
+    template <class Job>
+    void run(const Job& job) {
+        if (threads_.empty()) { job(0); return; }
+        job_ = &job;
+        invoke_ = [](const void* j, int idx) { (*static_cast<const Job*>(j))(idx); };
+        pending_.store((uint32_t)(size_ - 1), memory_order_relaxed);
+        start_round();
+        job(0);
+
+        // Wait for the workers' stripes: spin, then park until the last one wakes us
+        for (int i = 0; i < spin_ && pending_.load(memory_order_acquire) != 0; ++i) cpu_relax();
+        if (pending_.load(memory_order_acquire) != 0) {
+            leader_parked_.store(true);
+            for (uint32_t left; (left = pending_.load()) != 0;) futex_wait(pending_, left);
+            leader_parked_.store(false, memory_order_relaxed);
+        }
+    }
+
+private:
+    /// Publish job_/stop_ with a new epoch and wake any parked worker
+    void start_round() {
+        epoch_.fetch_add(1);  // seq_cst, pairs with the parked_ increment in loop()
+        if (parked_.load() != 0) futex_wake_all(epoch_);
+    }
+
+    /// Pool thread idx: wait for the next epoch, run its share, count down pending_
+    void loop(int idx) {
+        uint32_t seen = 0;
+        for (;;) {
+            for (int i = 0; i < spin_ && epoch_.load(memory_order_acquire) == seen; ++i) cpu_relax();
+            if (epoch_.load(memory_order_acquire) == seen) {
+                parked_.fetch_add(1);
+                while (epoch_.load() == seen) futex_wait(epoch_, seen);
+                parked_.fetch_sub(1, memory_order_relaxed);
+            }
+            seen = epoch_.load(memory_order_acquire);
+            if (stop_) return;
+            invoke_(job_, idx);
+            if (pending_.fetch_sub(1) == 1 && leader_parked_.load()) futex_wake_all(pending_);
+        }
+    }
+
+    const int size_;
+    const int spin_;                              ///< Polls before parking (0 when oversubscribed)
+    vector<thread> threads_;
+    const void* job_ = nullptr;                   ///< Current round's job, type-erased
+    void (*invoke_)(const void*, int) = nullptr;  ///< Calls job_ with its real type
+    bool stop_ = false;                           ///< Published by the final epoch bump
+    alignas(64) atomic<uint32_t> epoch_{0};       ///< Bumped by the caller once per round
+    atomic<uint32_t> parked_{0};                  ///< Workers asleep on epoch_
+    alignas(64) atomic<uint32_t> pending_{0};     ///< Worker stripes still running this round
+    atomic<bool> leader_parked_{false};           ///< Caller asleep on pending_
+};
+
+/**
+ * @struct DivtestSchedule
+ * @brief How is_prime_parallel() and is_prime_batch() split the divisor table and poll for early exit
+ */
+struct DivtestSchedule {
+    long long fanout_min = LLONG_MAX;  ///< Smaller n are tested inline on the calling thread (see calibrate_fanout())
+    bool blocked = false;              ///< Contiguous blocks per thread instead of interleaved stripes
+    int poll = 16;                     ///< Divisors tried between checks of the shared composite flag
+};
+
+/// An atomic flag alone on its cache line, so the threads polling it share nothing else
+struct alignas(64) PaddedFlag {
+    atomic<bool> value{false};
+};
+
+/// Per-candidate composite bits of a batch, alone on their cache line like PaddedFlag
+struct alignas(64) PaddedMask {
+    atomic<uint64_t> value{0};
+};
+
 /**
  * @brief Test if a number is prime using parallel divisibility testing
  * @param n The number to test for primality
- * @param T Number of threads to use for divisibility testing
+ * @param pool Persistent threads that share the divisibility tests
+ * @param divisors Odd primes up to at least √n (see make_trial_divisors())
+ * @param sched Fan-out threshold, divisor partitioning and polling interval
  * @return true if n is prime, false otherwise
  * 
  * This function uses a parallel approach to test primality:
  * 1. Handles special cases (< 2, divisible by 2 or 3)
- * 2. Spawns T worker threads to test divisibility in parallel
- * 3. Each thread tests a subset of potential divisors from 5 to √n
- * 4. Threads are interleaved: thread i tests divisors 5+2i, 5+2i+2T, 5+2i+4T, ...
- * 5. Skips multiples of 3 (optimization since already tested)
- * 6. Uses atomic flag for early termination when any divisor is found
+ * 2. Hands the test to the T threads of the pool as one round, unless n < sched.fanout_min
+ * 3. The primes from 5 up to √n are split among the threads, either interleaved
+ *    (thread i tests divisors[1+i], divisors[1+i+T], ...) or, with sched.blocked,
+ *    as T contiguous blocks
+ * 4. Only primes are tried, each with a multiply-and-compare instead of n % p
+ * 5. Uses atomic flag for early termination when any divisor is found
  * 
  * Thread coordination:
- * - atomic<bool> composite: Shared flag indicating if a divisor was found
+ * - composite: Shared flag on its own cache line, set if any thread finds a divisor
  * - memory_order_relaxed: Used for performance (strict ordering not required)
- * - Early exit: Threads check the flag and stop if another thread found a divisor
- * 
- * Performance notes:
- * - Best for testing very large individual numbers where √n is large
- * - Thread creation overhead is significant for small numbers
- * - Early termination reduces wasted work for composite numbers
+ * - Early exit: Threads check the flag every sched.poll divisors and stop if another
+ *   thread found a divisor
  */
-bool is_prime_parallel(long long n, int T) {
+bool is_prime_parallel(long long n, WorkerPool& pool, const vector<TrialDivisor>& divisors, const DivtestSchedule& sched) {
     if (n < 2) return false;
     if (n % 2 == 0) return n == 2;
     if (n % 3 == 0) return n == 3;
     long long hi = (long long)floor(sqrt((long double)n));
-    if (hi < 5) return true;
+    if (hi < 5) return true;  // No more divisors to check
+
+    // divisors[0] is 3, already tested above; the rest up to √n are divisors[1..last)
+    const size_t last = (size_t)(upper_bound(divisors.begin(), divisors.end(), hi,
+                                             [](long long v, const TrialDivisor& d) { return v < (long long)d.p; }) -
+                                 divisors.begin());
+    const size_t span = last - 1;
+
+    // Shared atomic flag: set to true if any thread finds a divisor
+    PaddedFlag composite;
+    const int T = (n < sched.fanout_min) ? 1 : pool.size();
+    const size_t poll = (size_t)sched.poll;
+
+    /**
+     * @brief Worker lambda for parallel divisibility testing
+     * @param idx Thread index (0 to T-1)
+     * 
+     * Striped: thread idx tests divisors[1+idx], divisors[1+idx+T], ..., so small
+     * and large divisors are spread evenly and every thread sees the small primes
+     * that catch most composites. Blocked: thread idx tests one contiguous run,
+     * which it streams through without touching its neighbours' cache lines.
+     * Either way every prime up to √n is tested by exactly one thread.
+     */
+    auto worker = [&](int idx) {
+        size_t i, end, step;
+        if (sched.blocked) {
+            i = 1 + span * (size_t)idx / (size_t)T;
+            end = 1 + span * (size_t)(idx + 1) / (size_t)T;
+            step = 1;
+        } else {
+            i = 1 + (size_t)idx;
+            end = last;
+            step = (size_t)T;
+        }
+        while (i < end) {
+            if (composite.value.load(memory_order_relaxed)) return;
+            const size_t until = min(end, i + poll * step);
+            for (; i < until; i += step) {
+                if (divisors[i].divides((uint64_t)n)) { composite.value.store(true, memory_order_relaxed); return; }
+            }
+        }
+    };
 
-    atomic<bool> composite{false};
-    vector<thread> workers;
-    workers.reserve((size_t)T);
+    if (T == 1) {
+        worker(0);  // Small n: the whole table inline, no round trip
+    } else {
+        // One round on the pool; returns once every thread has stopped
+        pool.run(worker);
+    }
+    return !composite.value.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Test K consecutive numbers with a single pool round
+ * @param lo First number of the batch
+ * @param K Batch size, 1..kMaxBatch
+ * @param pool Persistent threads that share the divisibility tests
+ * @param divisors Odd primes up to at least √(lo + K - 1)
+ * @param sched Fan-out threshold (batches ending below it run inline), divisor partitioning and polling interval
+ * @param prime Output: prime[c] is set to whether lo + c is prime
+ * 
+ * The batch analogue of is_prime_parallel(): the table up to the largest √n is
+ * split into the same stripes or blocks, but each thread walks its share once
+ * for all K candidates. Every divisor is loaded once and tried on every
+ * candidate still open, so a batch costs one synchronization instead of K.
+ * Candidates settled by 2, 3 or a tiny √n never reach the pool. The
+ * per-candidate composite flags are the bits of one padded atomic word, read
+ * every sched.poll divisors. Each thread drops a candidate from its own walk
+ * once it is marked composite or its √n is passed, and stops when none are left.
+ */
+void is_prime_batch(long long lo, int K, WorkerPool& pool, const vector<TrialDivisor>& divisors,
+                    const DivtestSchedule& sched, bool* prime) {
+    uint64_t open = 0;  // Candidates that still need the divisor table
+    long long hi[kMaxBatch];
+    long long top = 0;
+    for (int c = 0; c < K; ++c) {
+        const long long n = lo + c;
+        hi[c] = (long long)floor(sqrt((long double)n));
+        if (n < 2 || (n % 2 == 0 && n != 2) || (n % 3 == 0 && n != 3)) prime[c] = false;
+        else if (hi[c] < 5) prime[c] = true;
+        else { open |= 1ULL << c; top = hi[c]; }
+    }
+    if (open == 0) return;
+
+    // Same split as is_prime_parallel(), over divisors[1..last) up to the largest √n
+    const size_t last = (size_t)(upper_bound(divisors.begin(), divisors.end(), top,
+                                             [](long long v, const TrialDivisor& d) { return v < (long long)d.p; }) -
+                                 divisors.begin());
+    const size_t span = last - 1;
+
+    PaddedMask composite;
+    const int T = (lo + K - 1 < sched.fanout_min) ? 1 : pool.size();
+    const size_t poll = (size_t)sched.poll;
 
     auto worker = [&](int idx) {
-        long long start = 5 + 2LL * idx;
-        for (long long d = start; d <= hi && !composite.load(memory_order_relaxed); d += 2LL * T) {
-            if (d % 3 == 0) continue;
-            if (n % d == 0) { composite.store(true, memory_order_relaxed); break; }
+        size_t i, end, step;
+        if (sched.blocked) {
+            i = 1 + span * (size_t)idx / (size_t)T;
+            end = 1 + span * (size_t)(idx + 1) / (size_t)T;
+            step = 1;
+        } else {
+            i = 1 + (size_t)idx;
+            end = last;
+            step = (size_t)T;
+        }
+        uint64_t mine = open;
+        while (mine && i < end) {
+            mine &= ~composite.value.load(memory_order_relaxed);
+            const size_t until = min(end, i + poll * step);
+            for (; mine && i < until; i += step) {
+                const TrialDivisor d = divisors[i];
+                for (uint64_t m = mine; m; m &= m - 1) {
+                    const int c = __builtin_ctzll(m);
+                    if (d.p > hi[c]) mine &= ~(1ULL << c);  // Past √n: nothing left to try for c
+                    else if (d.divides((uint64_t)(lo + c))) {
+                        mine &= ~(1ULL << c);
+                        composite.value.fetch_or(1ULL << c, memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    };
+
+    if (T == 1) {
+        worker(0);
+    } else {
+        pool.run(worker);
+    }
+    const uint64_t found = composite.value.load(memory_order_relaxed);
+    for (int c = 0; c < K; ++c) {
+        if ((open >> c) & 1) prime[c] = ((found >> c) & 1) == 0;
+    }
+}
+
+/**
+ * @brief Measure the wall-clock time of a callable
+ * @param f Work to time
+ * @return Elapsed seconds
+ */
+template <class F>
+double time_seconds(F f) {
+    const auto t0 = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+/**
+ * @brief Measure the smallest n worth handing to the pool in is_prime_parallel()
+ * @param pool Pool the parallel path would use
+ * @param divisors Divisor table the tests will use
+ * @param batch Candidates per round (1 for is_prime_parallel(), else is_prime_batch())
+ * @param sched Schedule the timed rounds use; its fanout_min is ignored
+ * @return Smallest n to fan out, or LLONG_MAX if the pool never won within the table
+ * 
+ * Testing a prime n scans k divisors, k being the number of primes up to √n. For
+ * k = 16, 32, 64, ... the first prime above divisors[k]² (or the batch starting
+ * there) is timed both inline and as one pool round, best of 5 runs each. A
+ * prime keeps the early exit from favouring either path. The first k where the pool round wins gives the
+ * crossover n = divisors[k]².
+ * On a machine with fewer cores than threads the pool rarely wins, so divtest
+ * then runs inline.
+ */
+long long calibrate_fanout(WorkerPool& pool, const vector<TrialDivisor>& divisors, int batch, DivtestSchedule sched) {
+    if (pool.size() <= 1) return LLONG_MAX;
+    volatile bool sink = false;  // Keeps the timed tests from being optimized away
+    bool flags[kMaxBatch];
+    for (size_t k = 16; k + 1 < divisors.size(); k *= 2) {
+        const long long start = (long long)divisors[k].p * divisors[k].p;
+        long long n = start + 2;  // Below divisors[k + 1]², so the table still covers √n
+        sched.fanout_min = LLONG_MAX;
+        while (!is_prime_parallel(n, pool, divisors, sched)) n += 2;
+        const size_t reps = max<size_t>(1, 4096 / k);
+        auto best = [&](long long fanout_min) {
+            double t = 1e30;
+            for (int run = 0; run < 5; ++run) {
+                t = min(t, time_seconds([&] {
+                    for (size_t r = 0; r < reps; ++r) {
+                        sched.fanout_min = fanout_min;
+                        if (batch == 1) {
+                            sink = is_prime_parallel(n, pool, divisors, sched);
+                        } else {
+                            is_prime_batch(n, batch, pool, divisors, sched, flags);
+                            sink = flags[0];
+                        }
+                    }
+                }));
+            }
+            return t;
+        };
+        if (best(0) < best(LLONG_MAX)) return start;
+    }
+    return LLONG_MAX;
+}
+
+/**
+ * @brief Time the striped and blocked divisor schedules over [lo, hi]
+ * @param lo First number of the window
+ * @param hi Last number of the window
+ * @param pool Threads for the parallel tests
+ * @param divisors Odd primes up to at least √hi
+ * @param poll Polling interval to compare against polling on every divisor
+ * 
+ * Every n in the window is handed to the pool (no inline fallback), once per
+ * combination of schedule and polling interval. Each run prints a [BENCH] line
+ * with its prime count, which must agree, and its wall-clock time.
+ */
+void benchmark_schedules(long long lo, long long hi, WorkerPool& pool, const vector<TrialDivisor>& divisors, int poll) {
+    vector<int> polls = {1};
+    if (poll != 1) polls.push_back(poll);
+    for (bool blocked : {false, true}) {
+        for (int p : polls) {
+            DivtestSchedule sched;
+            sched.fanout_min = 0;
+            sched.blocked = blocked;
+            sched.poll = p;
+            long long count = 0;
+            const double t = time_seconds([&] {
+                for (long long n = lo; n <= hi; ++n) {
+                    count += is_prime_parallel(n, pool, divisors, sched);
+                    if (n == hi) break;  // Keep ++n from overflowing when hi is 2^63 - 1
+                }
+            });
+            cout << "[BENCH] schedule=" << (blocked ? "block" : "stripe") << " poll=" << p
+                 << " primes=" << count << " time=" << t << "s\n";
+        }
+    }
+}
+
+/**
+ * @struct Montgomery64
+ * @brief Montgomery arithmetic modulo a fixed odd 64-bit modulus
+ * 
+ * Residues are kept in the form a·R mod n with R = 2^64, so a modular product
+ * becomes one 64×64→128 multiply plus a REDC step (two more multiplies and a
+ * subtraction) instead of a 128-by-64 division. The only divisions happen
+ * once, in the constructor, to compute R² mod n.
+ */
+struct Montgomery64 {
+    unsigned long long n;     ///< Odd modulus
+    unsigned long long ninv;  ///< n^-1 mod 2^64
+    unsigned long long r2;    ///< R² mod n, used to convert into Montgomery form
+    unsigned long long one;   ///< R mod n, i.e. 1 in Montgomery form
+
+    /**
+     * @brief Precompute the constants for modulus m
+     * @param m Odd modulus (> 1)
+     */
+    explicit Montgomery64(unsigned long long m) : n(m) {
+        ninv = m;  // Correct to 3 bits for odd m; each Newton step doubles that
+        for (int i = 0; i < 5; ++i) ninv *= 2 - m * ninv;
+        one = (0 - m) % m;
+        r2 = one >= m - one ? one - (m - one) : one + one;  // 2·R mod n
+        for (int i = 0; i < 6; ++i) r2 = mul(r2, r2);       // Squaring 2^k·R gives 2^2k·R; avoids a 128-bit remainder
+    }
+
+    /**
+     * @brief Montgomery reduction: t·R^-1 mod n
+     * @param t Value below n·R
+     * @return Reduced value in [0, n)
+     * 
+     * Subtracts q·n with q = t·n^-1 mod R, so the low 64 bits cancel exactly
+     * and only the high halves need to be compared.
+     */
+    inline unsigned long long reduce(unsigned __int128 t) const {
+        unsigned long long q = (unsigned long long)t * ninv;
+        unsigned long long qn_hi = (unsigned long long)(((unsigned __int128)q * n) >> 64);
+        unsigned long long t_hi = (unsigned long long)(t >> 64);
+        return t_hi >= qn_hi ? t_hi - qn_hi : t_hi - qn_hi + n;
+    }
+
+    /// Convert a (< n) into Montgomery form
+    inline unsigned long long to_mont(unsigned long long a) const { return reduce((unsigned __int128)a * r2); }
+    /// Convert a Montgomery-form residue back to an ordinary one
+    inline unsigned long long from_mont(unsigned long long a) const { return reduce(a); }
+    /// Product of two Montgomery-form residues
+    inline unsigned long long mul(unsigned long long a, unsigned long long b) const {
+        return reduce((unsigned __int128)a * b);
+    }
+
+    /**
+     * @brief Binary exponentiation in Montgomery form
+     * @param a Base in Montgomery form
+     * @param e Exponent
+     * @return a^e in Montgomery form
+     */
+    inline unsigned long long pow(unsigned long long a, unsigned long long e) const {
+        unsigned long long result = one;
+        for (; e > 0; e >>= 1) {
+            if (e & 1) result = mul(result, a);
+            a = mul(a, a);
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Test if a number is prime using deterministic Miller–Rabin
+ * @param n The number to test for primality
+ * @return true if n is prime, false otherwise
+ * 
+ * Small primes up to 37 are handled by division, then n - 1 = d·2^s is tested
+ * as a strong probable prime to the 7 bases 2, 325, 9375, 28178, 450775,
+ * 9780504 and 1795265022, which has no 64-bit counterexamples (Sinclair).
+ * Cost is O(log n) Montgomery multiplications instead of O(√n) divisions.
+ */
+inline bool is_prime_mr(long long n) {
+    if (n < 2) return false;
+    for (long long p : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+        if (n % p == 0) return n == p;
+    }
+    if (n < 41 * 41) return true;
+    const unsigned long long m = (unsigned long long)n;
+    const Montgomery64 mont(m);
+    const unsigned long long minus_one = m - mont.one;  // -1 in Montgomery form
+    unsigned long long d = m - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    for (unsigned long long a : {2ULL, 325ULL, 9375ULL, 28178ULL, 450775ULL, 9780504ULL, 1795265022ULL}) {
+        a %= m;
+        if (a == 0) continue;  // Base is a multiple of n: no information
+        unsigned long long x = mont.pow(mont.to_mont(a), d);
+        if (x == mont.one || x == minus_one) continue;
+        bool witness = true;
+        for (int r = 1; r < s && witness; ++r) {
+            x = mont.mul(x, x);
+            if (x == minus_one) witness = false;
+        }
+        if (witness) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Full 128×128→256-bit product
+ * @param a First factor
+ * @param b Second factor
+ * @param hi Receives the upper 128 bits
+ * @return The lower 128 bits
+ */
+inline u128 mul_wide_u128(u128 a, u128 b, u128& hi) {
+    const u128 a0 = (uint64_t)a, a1 = a >> 64, b0 = (uint64_t)b, b1 = b >> 64;
+    const u128 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    const u128 mid = (p00 >> 64) + (uint64_t)p01 + (uint64_t)p10;  // < 3·2^64, cannot overflow
+    hi = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+    return (mid << 64) | (uint64_t)p00;
+}
+
+/**
+ * @struct Montgomery128
+ * @brief Montgomery arithmetic modulo a fixed odd 128-bit modulus (R = 2^128)
+ * 
+ * The 128-bit counterpart of Montgomery64: a product is one 256-bit multiply
+ * built from four 64×64 multiplies plus a REDC step, with no 256-by-128 division.
+ */
+struct Montgomery128 {
+    u128 n;     ///< Odd modulus
+    u128 ninv;  ///< n^-1 mod 2^128
+    u128 r2;    ///< R² mod n, used to convert into Montgomery form
+    u128 one;   ///< R mod n, i.e. 1 in Montgomery form
+
+    /**
+     * @brief Precompute the constants for modulus m
+     * @param m Odd modulus (> 1)
+     */
+    explicit Montgomery128(u128 m) : n(m) {
+        ninv = m;  // Correct to 3 bits for odd m; each Newton step doubles that
+        for (int i = 0; i < 6; ++i) ninv *= 2 - m * ninv;
+        one = (0 - m) % m;
+        r2 = one;
+        for (int i = 0; i < 128; ++i) r2 = add(r2, r2);  // Doubling avoids a 256-bit remainder
+    }
+
+    /**
+     * @brief Montgomery reduction: (hi·R + lo)·R^-1 mod n
+     * @param hi Upper half of a value below n·R (so hi < n)
+     * @param lo Lower half
+     * @return Reduced value in [0, n)
+     */
+    inline u128 reduce(u128 hi, u128 lo) const {
+        u128 qn_hi;
+        mul_wide_u128(lo * ninv, n, qn_hi);
+        return hi >= qn_hi ? hi - qn_hi : hi - qn_hi + n;
+    }
+
+    /// Sum of two residues mod n
+    inline u128 add(u128 a, u128 b) const { return a >= n - b ? a - (n - b) : a + b; }
+    /// Difference of two residues mod n
+    inline u128 sub(u128 a, u128 b) const { return a >= b ? a - b : a + (n - b); }
+    /// Product of two Montgomery-form residues
+    inline u128 mul(u128 a, u128 b) const {
+        u128 hi;
+        const u128 lo = mul_wide_u128(a, b, hi);
+        return reduce(hi, lo);
+    }
+    /// Convert a (< n) into Montgomery form
+    inline u128 to_mont(u128 a) const { return mul(a, r2); }
+
+    /**
+     * @brief Binary exponentiation in Montgomery form
+     * @param a Base in Montgomery form
+     * @param e Exponent
+     * @return a^e in Montgomery form
+     */
+    inline u128 pow(u128 a, u128 e) const {
+        u128 result = one;
+        for (; e > 0; e >>= 1) {
+            if (e & 1) result = mul(result, a);
+            a = mul(a, a);
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Integer square root of a 128-bit value
+ * @param n Input value
+ * @return floor(√n)
+ */
+inline u128 isqrt_u128(u128 n) {
+    const u128 cap = ~0ULL;  // floor(√(2^128 - 1))
+    u128 r = (u128)sqrtl((long double)n);
+    if (r > cap) r = cap;
+    // long double may be as narrow as double, so step the estimate onto the exact root
+    if (r > 0) r = min(cap, (r + n / r) / 2);
+    while (r * r > n) --r;
+    while (r < cap && (r + 1) * (r + 1) <= n) ++r;
+    return r;
+}
+
+/**
+ * @brief Jacobi symbol (a/n)
+ * @param a Numerator
+ * @param n Odd positive denominator
+ * @return -1, 0 or 1
+ */
+inline int jacobi_u128(u128 a, u128 n) {
+    int t = 1;
+    a %= n;
+    while (a != 0) {
+        while ((a & 1) == 0) {
+            a >>= 1;
+            const unsigned r = (unsigned)(n & 7);
+            if (r == 3 || r == 5) t = -t;
+        }
+        swap(a, n);
+        if ((a & 3) == 3 && (n & 3) == 3) t = -t;
+        a %= n;
+    }
+    return (n == 1) ? t : 0;
+}
+
+/**
+ * @brief Strong Lucas probable-prime test with Selfridge parameters
+ * @param n Odd candidate above 2^63 with no small factors
+ * @param mont Montgomery context for n
+ * @return true if n is a strong Lucas probable prime
+ * 
+ * Picks the first D in 5, -7, 9, -11, ... with (D/n) = -1 and uses P = 1,
+ * Q = (1 - D) / 4. With n + 1 = d·2^s, n passes if U_d ≡ 0 or V_{d·2^r} ≡ 0
+ * for some 0 ≤ r < s. Only the V sequence is computed: U_d ≡ 0 exactly when
+ * 2·V_{d+1} ≡ P·V_d, since D·U_k = 2·V_{k+1} - P·V_k and gcd(D, n) = 1.
+ */
+inline bool is_strong_lucas_prp(u128 n, const Montgomery128& mont) {
+    // A perfect square has no D with (D/n) = -1, so the search would never end
+    const u128 root = isqrt_u128(n);
+    if (root * root == n) return false;
+    long long D = 5;
+    for (;; D = (D > 0) ? -(D + 2) : -D + 2) {
+        const int j = jacobi_u128((D > 0) ? (u128)D : n - (u128)(-D), n);
+        if (j == -1) break;
+        if (j == 0) return false;  // |D| < n shares a factor with n
+    }
+    const long long Q = (1 - D) / 4;
+    const u128 q = mont.to_mont((Q >= 0) ? (u128)Q : n - (u128)(-Q));
+    const u128 two = mont.add(mont.one, mont.one);
+
+    u128 d = n + 1;  // n is odd and not 2^128 - 1 (a multiple of 3), so this cannot wrap
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+
+    // Ladder over the bits of d keeping (V_k, V_{k+1}, Q^k), starting at k = 0
+    u128 vk = two, vk1 = mont.one, qk = mont.one;
+    const int top = (d >> 64) ? 127 - __builtin_clzll((uint64_t)(d >> 64)) : 63 - __builtin_clzll((uint64_t)d);
+    for (int bit = top; bit >= 0; --bit) {
+        const u128 cross = mont.sub(mont.mul(vk, vk1), qk);  // V_{2k+1} = V_k·V_{k+1} - P·Q^k
+        if ((d >> bit) & 1) {
+            const u128 qk1 = mont.mul(qk, q);
+            vk = cross;
+            vk1 = mont.sub(mont.mul(vk1, vk1), mont.add(qk1, qk1));  // V_{2k+2} = V_{k+1}² - 2·Q^{k+1}
+            qk = mont.mul(qk, qk1);
+        } else {
+            vk1 = cross;
+            vk = mont.sub(mont.mul(vk, vk), mont.add(qk, qk));  // V_{2k} = V_k² - 2·Q^k
+            qk = mont.mul(qk, qk);
+        }
+    }
+    if (mont.add(vk1, vk1) == vk || vk == 0) return true;
+    for (int r = 1; r < s; ++r) {
+        vk = mont.sub(mont.mul(vk, vk), mont.add(qk, qk));
+        if (vk == 0) return true;
+        qk = mont.mul(qk, qk);
+    }
+    return false;
+}
+
+/**
+ * @brief Test if a number is prime using the Baillie–PSW test
+ * @param n The number to test for primality
+ * @return true if n is prime (or a BPSW pseudoprime, none of which is known)
+ * 
+ * Values below 2^63 go to the deterministic is_prime_mr(). Larger ones are
+ * trial-divided by the primes up to 53, then must pass a strong base-2
+ * Miller–Rabin round and a strong Lucas test, both in 128-bit Montgomery form.
+ */
+inline bool is_prime_bpsw(u128 n) {
+    if ((n >> 63) == 0) return is_prime_mr((long long)n);
+    for (unsigned p : {2u, 3u, 5u, 7u, 11u, 13u, 17u, 19u, 23u, 29u, 31u, 37u, 41u, 43u, 47u, 53u}) {
+        if (n % p == 0) return false;  // n > 2^63, so it cannot be p itself
+    }
+    const Montgomery128 mont(n);
+    const u128 minus_one = n - mont.one;
+    u128 d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; ++s; }
+    u128 x = mont.pow(mont.to_mont(2), d);
+    if (x != mont.one && x != minus_one) {
+        bool witness = true;
+        for (int r = 1; r < s && witness; ++r) {
+            x = mont.mul(x, x);
+            if (x == minus_one) witness = false;
+        }
+        if (witness) return false;
+    }
+    return is_strong_lucas_prp(n, mont);
+}
+
+/**
+ * @brief One Pollard–Brent rho walk on n with f(x) = x² + c
+ * @param mont Montgomery context for the odd composite n
+ * @param c Increment of the iteration, in Montgomery form
+ * @param stop Set by another walk that already found a factor
+ * @return A divisor of n: a proper factor on success, n on failure, 0 if stopped
+ * 
+ * Brent's cycle detection with products of |x - y| batched over 128 steps, so
+ * there is one gcd per batch instead of per step. If a batch overshoots (gcd = n)
+ * the walk replays it one step at a time from the saved ys. Everything stays in
+ * Montgomery form: gcd(a·R mod n, n) = gcd(a, n) because R is coprime to n.
+ */
+inline uint64_t brent_rho(const Montgomery64& mont, uint64_t c, const atomic<bool>& stop) {
+    const uint64_t n = mont.n;
+    auto f = [&](uint64_t v) {
+        const uint64_t sq = mont.mul(v, v);
+        return sq >= n - c ? sq - (n - c) : sq + c;
+    };
+    auto diff = [](uint64_t a, uint64_t b) { return a > b ? a - b : b - a; };
+    const uint64_t batch = 128;
+    uint64_t x = 0, y = mont.one, ys = y, q = mont.one, g = 1;
+    for (uint64_t r = 1; g == 1; r <<= 1) {
+        x = y;
+        for (uint64_t i = 0; i < r; ++i) y = f(y);
+        for (uint64_t k = 0; k < r && g == 1; k += batch) {
+            if (stop.load(memory_order_relaxed)) return 0;
+            ys = y;
+            for (uint64_t i = 0; i < min(batch, r - k); ++i) {
+                y = f(y);
+                q = mont.mul(q, diff(x, y));
+            }
+            g = gcd(q, n);
+        }
+    }
+    if (g == n) {
+        do {
+            ys = f(ys);
+            g = gcd(diff(x, ys), n);
+        } while (g == 1);
+    }
+    return g;
+}
+
+/**
+ * @brief Find a proper factor of an odd composite using parallel rho walks
+ * @param n Odd composite that is not a perfect power of a small prime
+ * @param pool Threads for the independent walks, one walk each
+ * @return A proper factor of n
+ * 
+ * Walk i starts with c = i + 1 and, if its cycle closes on n itself, moves on
+ * to c + T, so the walks never repeat each other's work. The first proper factor
+ * found is published and the other walks stop at their next batch. Below 2^40 a
+ * single walk finishes in microseconds, so it runs on the calling thread.
+ */
+uint64_t find_factor_parallel(uint64_t n, WorkerPool& pool) {
+    const Montgomery64 mont(n);
+    int T = pool.size();
+    atomic<bool> found{false};
+    atomic<uint64_t> factor{0};
+    auto walk = [&](int idx) {
+        for (uint64_t c = (uint64_t)idx + 1; !found.load(memory_order_relaxed); c += (uint64_t)T) {
+            const uint64_t g = brent_rho(mont, mont.to_mont(c % n), found);
+            if (g != 0 && g != n && !found.exchange(true)) factor.store(g);
+        }
+    };
+    if (T <= 1 || n < (1ULL << 40)) {
+        T = 1;
+        walk(0);
+        return factor.load();
+    }
+    pool.run(walk);
+    return factor.load();
+}
+
+/**
+ * @brief Factor a number into primes
+ * @param n Number to factor (>= 2, < 2^63)
+ * @param pool Threads for the rho walks
+ * @return Prime factors of n in ascending order, with multiplicity
+ * 
+ * Trial division strips the primes below 100; what remains is split by
+ * find_factor_parallel() and each part is recursed on until is_prime_mr()
+ * accepts it.
+ */
+vector<uint64_t> factorize(long long n, WorkerPool& pool) {
+    vector<uint64_t> factors;
+    uint64_t m = (uint64_t)n;
+    for (uint64_t p = 2; p < 100 && p * p <= m; p += (p == 2) ? 1 : 2) {
+        while (m % p == 0) { factors.push_back(p); m /= p; }
+    }
+    vector<uint64_t> pending;
+    if (m > 1) pending.push_back(m);
+    while (!pending.empty()) {
+        const uint64_t v = pending.back();
+        pending.pop_back();
+        if (is_prime_mr((long long)v)) { factors.push_back(v); continue; }
+        const uint64_t d = find_factor_parallel(v, pool);
+        pending.push_back(d);
+        pending.push_back(v / d);
+    }
+    sort(factors.begin(), factors.end());
+    return factors;
+}
+
+/**
+ * @brief Format a factorization as "p1*p2*..."
+ * @param factors Prime factors in ascending order
+ * @return The factors joined by '*'
+ */
+string format_factors(const vector<uint64_t>& factors) {
+    string s;
+    for (size_t i = 0; i < factors.size(); ++i) {
+        if (i > 0) s += '*';
+        s += to_string(factors[i]);
+    }
+    return s;
+}
+
+/// Fallback sieve window size when the cache topology cannot be detected (32 KiB)
+constexpr long long kSegmentBytes = 1LL << 15;
+/// Largest window accepted
+constexpr long long kMaxSegmentBytes = 1LL << 25;
+
+/**
+ * @struct CacheInfo
+ * @brief Per-core data cache capacities in bytes (0 when unknown)
+ */
+struct CacheInfo {
+    long long l1d = 0;
+    long long l2 = 0;
+};
+
+/**
+ * @brief Detect the L1d and L2 capacity available to one core
+ * @return Detected sizes; fields stay 0 when the platform does not report them
+ * 
+ * On Linux, reads /sys/devices/system/cpu/cpu0/cache/index* and divides shared
+ * caches by the number of CPUs sharing them, so each worker's segment fits its
+ * own share. Falls back to sysconf() where available and sysctl on macOS.
+ */
+CacheInfo detect_cache_sizes() {
+    CacheInfo info;
+#if defined(__linux__)
+    // Count CPUs in a list like "0-3,8-11"
+    auto count_cpus = [](const string& list) {
+        long long n = 0;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t comma = list.find(',', pos);
+            if (comma == string::npos) comma = list.size();
+            const string part = list.substr(pos, comma - pos);
+            const size_t dash = part.find('-');
+            if (!part.empty()) n += (dash == string::npos) ? 1 : stoll(part.substr(dash + 1)) - stoll(part.substr(0, dash)) + 1;
+            pos = comma + 1;
+        }
+        return max(1LL, n);
+    };
+    for (int idx = 0; idx < 8; ++idx) {
+        const string dir = "/sys/devices/system/cpu/cpu0/cache/index" + to_string(idx) + "/";
+        ifstream level_in(dir + "level"), type_in(dir + "type"), size_in(dir + "size"), shared_in(dir + "shared_cpu_list");
+        int level = 0;
+        string type, size, shared;
+        if (!(level_in >> level) || !(type_in >> type) || !(size_in >> size)) continue;
+        if (type == "Instruction" || size.empty()) continue;
+        long long bytes = stoll(size);
+        const char unit = size.back();
+        if (unit == 'K') bytes <<= 10;
+        else if (unit == 'M') bytes <<= 20;
+        if (shared_in >> shared) bytes /= count_cpus(shared);
+        if (level == 1) info.l1d = bytes;
+        else if (level == 2) info.l2 = bytes;
+    }
+#endif
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    if (info.l1d <= 0) info.l1d = max(0L, sysconf(_SC_LEVEL1_DCACHE_SIZE));
+    if (info.l2 <= 0) info.l2 = max(0L, sysconf(_SC_LEVEL2_CACHE_SIZE));
+#endif
+#if defined(__APPLE__)
+    auto sysctl_size = [](const char* name) {
+        int64_t v = 0;
+        size_t len = sizeof(v);
+        return (sysctlbyname(name, &v, &len, nullptr, 0) == 0) ? (long long)v : 0LL;
+    };
+    if (info.l1d <= 0) info.l1d = sysctl_size("hw.l1dcachesize");
+    if (info.l2 <= 0) info.l2 = sysctl_size("hw.l2cachesize");
+#endif
+    return info;
+}
+
+/**
+ * @brief Pick the sieve window size for one worker thread
+ * @param override_kb Configured segment size in KiB (<= 0 means automatic)
+ * @param cache Per-core cache capacities
+ * @return Window size in bytes, a multiple of 64 within [4 KiB, kMaxSegmentBytes]
+ * 
+ * The window plus the per-prime crossing state and the pre-sieve slice being
+ * copied should stay cache resident, so the automatic choice is a quarter of
+ * the per-core L2 share, or the full L1d when no L2 is reported, or
+ * kSegmentBytes when nothing is known.
+ */
+long long choose_segment_bytes(long long override_kb, const CacheInfo& cache) {
+    long long bytes = kSegmentBytes;
+    if (override_kb > 0) bytes = override_kb << 10;
+    else if (cache.l2 > 0) bytes = cache.l2 / 4;
+    else if (cache.l1d > 0) bytes = cache.l1d;
+    bytes = min(kMaxSegmentBytes, max(4096LL, bytes));
+    return bytes / 64 * 64;
+}
+
+/**
+ * @brief Integer square root
+ * @param n Non-negative value
+ * @return floor(√n), corrected for floating-point rounding
+ */
+inline long long isqrt_ll(long long n) {
+    long long r = (long long)sqrt((long double)n);
+    while (r > 0 && r > n / r) --r;           // r*r > n, without overflow
+    while (r + 1 <= n / (r + 1)) ++r;         // (r+1)² <= n, without overflow
+    return r;
+}
+
+/**
+ * @brief Generate the sieving primes up to √limit
+ * @param limit Upper bound of the whole search range
+ * @return All primes p with p*p <= limit, in ascending order
+ * 
+ * Runs a segmented odd-only Sieve of Eratosthenes over [0, √limit], so even
+ * limit=1e18 (primes up to 1e9) needs only one small segment plus the output.
+ * Every such prime fits in 32 bits. The table is built once in main() and
+ * shared read-only by every worker thread.
+ */
+vector<uint32_t> sieving_primes(long long limit) {
+    const long long r = isqrt_ll(limit);
+    vector<uint32_t> primes;
+    if (r < 2) return primes;
+    primes.reserve((size_t)(r / max(1.0, log((double)r) - 1.1)) + 16);
+    primes.push_back(2);
+
+    // Odd base primes up to √r, then odd numbers [lo, lo + 2*len) per segment
+    const long long rr = isqrt_ll(r);
+    vector<char> small_composite((size_t)rr + 1, 0);
+    vector<long long> base;
+    for (long long i = 3; i <= rr; i += 2) {
+        if (small_composite[i]) continue;
+        base.push_back(i);
+        for (long long j = i * i; j <= rr; j += 2 * i) small_composite[j] = 1;
+    }
+    const long long len = kSegmentBytes;  // Odd numbers per segment
+    vector<char> seg((size_t)len);
+    vector<long long> next(base.size());
+    for (size_t i = 0; i < base.size(); ++i) next[i] = base[i] * base[i];
+    for (long long lo = 3; lo <= r; lo += 2 * len) {
+        const long long hi = min(r, lo + 2 * len - 1);
+        memset(seg.data(), 1, (size_t)len);
+        for (size_t i = 0; i < base.size(); ++i) {
+            long long m = next[i];
+            for (; m <= hi; m += 2 * base[i]) seg[(m - lo) / 2] = 0;
+            next[i] = m;
+        }
+        for (long long n = lo; n <= hi; n += 2) {
+            if (seg[(n - lo) / 2]) primes.push_back((uint32_t)n);
+        }
+    }
+    return primes;
+}
+
+/// Residues modulo 30 coprime to 30; bit k of a wheel byte represents 30*i + kWheel[k]
+constexpr int kWheel[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+/// Distance from kWheel[k] to the next residue coprime to 30
+constexpr int kWheelGap[8] = {6, 4, 2, 4, 2, 4, 6, 2};
+
+/**
+ * @struct WheelTables
+ * @brief Crossing-off tables for the mod-30 wheel layout
+ * 
+ * For a sieving prime p = 30k + kWheel[c], the multiple p*q with q ≡ kWheel[j]
+ * (mod 30) lives in bit bit[c][j] of its byte. Stepping q to the next residue
+ * coprime to 30 advances the byte index by k*kWheelGap[j] + corr[c][j].
+ */
+struct WheelTables {
+    int8_t bit_of[30];   ///< Bit index of each residue mod 30, -1 if not coprime to 30
+    uint8_t mask[8][8];  ///< AND-mask clearing bit[c][j]
+    uint8_t corr[8][8];  ///< Byte-step correction from the residue product carry
+    constexpr WheelTables() : bit_of{}, mask{}, corr{} {
+        for (int r = 0; r < 30; ++r) bit_of[r] = -1;
+        for (int k = 0; k < 8; ++k) bit_of[kWheel[k]] = (int8_t)k;
+        for (int c = 0; c < 8; ++c) {
+            for (int j = 0; j < 8; ++j) {
+                const int w = kWheel[j];
+                const int w_next = w + kWheelGap[j];
+                mask[c][j] = (uint8_t)~(1u << bit_of[(kWheel[c] * w) % 30]);
+                corr[c][j] = (uint8_t)((kWheel[c] * w_next) / 30 - (kWheel[c] * w) / 30);
+            }
+        }
+    }
+};
+constexpr WheelTables kWheelTables{};
+
+/**
+ * @struct WheelPrime
+ * @brief Crossing-off state of one sieving prime p = 30k + kWheel[c]
+ * 
+ * next is the byte index (relative to the bitmap) of the next multiple p*q to
+ * cross off, and j is the wheel index of q mod 30.
+ */
+struct WheelPrime {
+    long long k;
+    int c;
+    long long next;
+    int j;
+};
+
+/**
+ * @brief Build the crossing-off state for prime p starting at the first multiple >= start
+ * @param p Sieving prime (>= 7)
+ * @param start Smallest number that may be crossed off (>= p²)
+ * @param base_byte Wheel byte index that the state's byte offsets are relative to
+ */
+inline WheelPrime make_wheel_prime(long long p, long long start, long long base_byte) {
+    const long long q = start / p + (start % p != 0);
+    int j = 0;
+    while (kWheel[j] < q % 30) ++j;  // kWheel[7] = 29 bounds every residue
+    // p*q may exceed LLONG_MAX near the top of the range, only its byte index matters
+    const __int128 m = (__int128)p * (q / 30 * 30 + kWheel[j]);
+    return WheelPrime{p / 30, kWheelTables.bit_of[p % 30], (long long)(m / 30) - base_byte, j};
+}
+
+/**
+ * @brief Cross off the multiples of one sieving prime up to a byte bound
+ * @param bytes Wheel bitmap storage
+ * @param end Byte index (exclusive) at which to stop
+ * @param wp Crossing state, advanced in place so the next window resumes from it
+ */
+inline void cross_off(uint8_t* bytes, long long end, WheelPrime& wp) {
+    long long i = wp.next;
+    int j = wp.j;
+    const uint8_t (&mask)[8] = kWheelTables.mask[wp.c];
+    const uint8_t (&corr)[8] = kWheelTables.corr[wp.c];
+    while (i < end) {
+        bytes[i] &= mask[j];
+        i += wp.k * kWheelGap[j] + corr[j];
+        j = (j + 1) & 7;
+    }
+    wp.next = i;
+    wp.j = j;
+}
+
+/// Primes whose multiples are pre-sieved into the periodic segment pattern
+constexpr long long kPresievePrimes[5] = {7, 11, 13, 17, 19};
+
+/**
+ * @brief Build the pre-sieved wheel pattern for kPresievePrimes
+ * @return 7·11·13·17·19 = 323323 wheel bytes with every multiple of those primes cleared
+ * 
+ * Because 30 is coprime to each pre-sieved prime, the wheel bytes of
+ * [0, 30·323323) repeat with that period. Every segment starts as a copy of the
+ * matching slice of this pattern, so only primes above 19 cross off per segment.
+ */
+vector<uint8_t> build_presieve_pattern() {
+    long long period = 1;
+    for (long long p : kPresievePrimes) period *= p;
+    vector<uint8_t> pattern((size_t)period, 0xff);
+    for (long long p : kPresievePrimes) {
+        WheelPrime wp = make_wheel_prime(p, p, 0);
+        cross_off(pattern.data(), period, wp);
+    }
+    return pattern;
+}
+
+/**
+ * @struct SieveContext
+ * @brief Read-only tables shared by every sieve worker, built once in main()
+ */
+struct SieveContext {
+    vector<uint32_t> primes;   ///< Sieving primes up to √limit
+    vector<uint8_t> presieve;  ///< Periodic pattern with kPresievePrimes crossed off
+    long long segment_bytes = kSegmentBytes;  ///< Window size per worker, from choose_segment_bytes()
+};
+
+/**
+ * @class WheelBitmap
+ * @brief Bit-packed set of primes in [lo, hi] in the modulo-30 wheel layout
+ * 
+ * Byte i covers the 30 integers [30i, 30i + 30); its 8 bits represent the
+ * residues in kWheel, the only ones that can be prime above 5. The wheel primes
+ * 2, 3 and 5 are tracked by separate flags. Bytes are stored in 64-bit words so
+ * counting uses word-level popcount and enumeration uses count-trailing-zeros,
+ * neither of which needs a materialized vector of primes.
+ */
+class WheelBitmap {
+public:
+    /**
+     * @brief Cover [lo, hi]; the storage is zeroed until init_window() fills it
+     * @param lo Start of the range (inclusive)
+     * @param hi End of the range (inclusive)
+     */
+    void reset(long long lo, long long hi) {
+        small_.clear();
+        for (long long p : {2LL, 3LL, 5LL}) {
+            if (lo <= p && p <= hi) small_.push_back(p);
+        }
+        lo_ = max(1LL, lo);
+        hi_ = hi;
+        base_ = lo_ / 30;
+        bytes_ = (hi_ >= lo_) ? hi_ / 30 - base_ + 1 : 0;
+        words_.assign((size_t)((bytes_ + 7) / 8), 0);
+    }
+
+    /**
+     * @brief Initialize bytes [w0, w1) as sieve candidates before crossing off
+     * @param w0 First byte of the window (inclusive)
+     * @param w1 Last byte of the window (exclusive)
+     * @param pattern Pre-sieved pattern indexed by absolute wheel byte modulo its size
+     * 
+     * The window is copied from the periodic pattern, so multiples of the
+     * pre-sieved primes are already cleared. The pre-sieved primes themselves,
+     * the number 1 and the residues outside [lo, hi] are then fixed up.
+     */
+    void init_window(long long w0, long long w1, const vector<uint8_t>& pattern) {
+        uint8_t* b = bytes();
+        const long long period = (long long)pattern.size();
+        long long off = (base_ + w0) % period;
+        for (long long i = w0; i < w1; off = 0) {
+            const long long n = min(w1 - i, period - off);
+            memcpy(b + i, pattern.data() + off, (size_t)n);
+            i += n;
+        }
+        for (long long p : kPresievePrimes) {
+            const long long i = p / 30 - base_;
+            if (lo_ <= p && p <= hi_ && w0 <= i && i < w1) b[i] |= (uint8_t)(1u << kWheelTables.bit_of[p % 30]);
+        }
+        if (w0 == 0 && base_ == 0) b[0] &= (uint8_t)~1u;  // 1 is not prime
+        // Compared as offsets within the edge bytes: the last byte's residues may exceed LLONG_MAX
+        for (int k = 0; k < 8; ++k) {
+            if (w0 == 0 && kWheel[k] < lo_ - base_ * 30) b[0] &= (uint8_t)~(1u << k);
+            if (w1 == bytes_ && kWheel[k] > hi_ - (base_ + bytes_ - 1) * 30) b[bytes_ - 1] &= (uint8_t)~(1u << k);
+        }
+    }
+
+    long long base_byte() const { return base_; }   ///< Wheel byte index of bytes()[0]
+    long long byte_count() const { return bytes_; }  ///< Number of wheel bytes covered
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(words_.data()); }  ///< Raw storage for sieving
+    uint64_t* words() { return words_.data(); }      ///< Raw storage as 64-bit words
+    size_t word_count() const { return words_.size(); }
+
+    /// @return Number of primes in the set
+    size_t count() const {
+        size_t total = small_.size();
+        for (uint64_t w : words_) total += (size_t)__builtin_popcountll(w);
+        return total;
+    }
+
+    /**
+     * @brief Visit every prime in the set in ascending order
+     * @param f Callback invoked as f(long long prime)
+     */
+    template <class F>
+    void for_each(F&& f) const {
+        for (long long p : small_) f(p);
+        for (size_t wi = 0; wi < words_.size(); ++wi) {
+            for (uint64_t w = word_le(wi); w != 0; w &= w - 1) {
+                const int bit = __builtin_ctzll(w);
+                f((base_ + (long long)wi * 8 + bit / 8) * 30 + kWheel[bit % 8]);
+            }
+        }
+    }
+
+private:
+    /// Word wi with byte 0 in the low bits, independent of host byte order
+    uint64_t word_le(size_t wi) const {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_bswap64(words_[wi]);
+#else
+        return words_[wi];
+#endif
+    }
+
+    vector<uint64_t> words_;
+    vector<long long> small_;
+    long long lo_ = 1;
+    long long hi_ = 0;
+    long long base_ = 0;
+    long long bytes_ = 0;
+};
+
+/**
+ * @class Barrier
+ * @brief Reusable barrier for a fixed number of threads
+ * 
+ * The last thread to arrive starts a new generation and wakes the others, so
+ * the same barrier can separate any number of consecutive phases.
+ */
+class Barrier {
+public:
+    explicit Barrier(int count) : count_(count), waiting_(0), generation_(0) {}
+
+    /// Block until all threads of the current generation have arrived
+    void arrive_and_wait() {
+        unique_lock<mutex> lk(mtx_);
+        const unsigned long long gen = generation_;
+        if (++waiting_ == count_) {
+            waiting_ = 0;
+            ++generation_;
+            cv_.notify_all();
+            return;
+        }
+        cv_.wait(lk, [&] { return generation_ != gen; });
+    }
+
+private:
+    mutex mtx_;
+    condition_variable cv_;
+    const int count_;
+    int waiting_;
+    unsigned long long generation_;
+};
+
+/**
+ * @brief Sieve [lo, hi] with T threads cooperating on each segment
+ * @param lo Start of the range (inclusive)
+ * @param hi End of the range (inclusive)
+ * @param T Number of sieving threads
+ * @param ctx Shared sieving primes (covering at least √hi), pre-sieve pattern and segment size
+ * @param emit Callback invoked as emit(WheelBitmap&) with each finished segment, in order
+ * 
+ * This is the sieve analogue of is_prime_parallel(): instead of splitting the
+ * numbers, the threads split the divisors. Segments are processed one at a time
+ * and the sieving primes are striped across threads (prime i belongs to thread
+ * i % T, like divisor stripes). Each segment takes two phases separated by
+ * barriers:
+ * 1. Every thread crosses off its own primes' multiples in a private buffer.
+ * 2. Every thread ANDs all private buffers over its own slice of words into the
+ *    shared segment, so no two threads ever write the same word and no atomics
+ *    are needed.
+ * Thread 0 then hands the finished segment to emit() before starting the next one.
+ */
+template <class Emit>
+void sieve_cooperative(long long lo, long long hi, int T, const SieveContext& ctx, Emit&& emit) {
+    lo = max(2LL, lo);
+    if (hi < lo) return;
+    const long long base = lo / 30;
+    const long long total = hi / 30 - base + 1;
+    const long long seg = ctx.segment_bytes;
+
+    // Striped ownership of sieving primes; crossing state is relative to the current segment
+    vector<vector<WheelPrime>> owned((size_t)T);
+    size_t index = 0;
+    for (uint32_t prime : ctx.primes) {
+        const long long p = prime;
+        if (p <= kPresievePrimes[4]) continue;
+        if (p * p > hi) break;
+        const WheelPrime wp = make_wheel_prime(p, max(p * p, lo), base);
+        if (wp.next >= total) continue;  // First multiple lies past hi, nothing to cross off
+        owned[index++ % (size_t)T].push_back(wp);
+    }
+
+    WheelBitmap shared;
+    vector<vector<uint64_t>> priv((size_t)T, vector<uint64_t>((size_t)(seg / 8)));
+    Barrier barrier(T);
+
+    auto worker = [&](int t) {
+        uint8_t* mine = reinterpret_cast<uint8_t*>(priv[(size_t)t].data());
+        for (long long g0 = 0; g0 < total; g0 += seg) {
+            const long long len = min(seg, total - g0);
+            if (t == 0) {
+                // Only thread 0 touches the shared segment outside phase 2
+                // The last segment ends at hi itself; (base + g0 + len) * 30 could pass LLONG_MAX there
+                shared.reset(max(lo, (base + g0) * 30), (base + g0 + len > hi / 30) ? hi : (base + g0 + len) * 30 - 1);
+                shared.init_window(0, len, ctx.presieve);
+            }
+            // Phase 1: cross off this thread's primes in its private buffer
+            memset(mine, 0xff, (size_t)len);
+            for (auto& wp : owned[(size_t)t]) {
+                cross_off(mine, len, wp);
+                wp.next -= len;
+            }
+            barrier.arrive_and_wait();
+
+            // Phase 2: merge every private buffer into this thread's slice of words
+            const long long words = (long long)shared.word_count();
+            const long long w0 = words * t / T;
+            const long long w1 = words * (t + 1) / T;
+            uint64_t* out = shared.words();
+            for (long long w = w0; w < w1; ++w) {
+                uint64_t acc = out[w];
+                for (int u = 0; u < T; ++u) acc &= priv[(size_t)u][(size_t)w];
+                out[w] = acc;
+            }
+            barrier.arrive_and_wait();
+
+            if (t == 0) emit(shared);
         }
     };
 
-    for (int i = 0; i < T; ++i) workers.emplace_back(worker, i);
-    for (auto& th : workers) th.join();
-    return !composite.load(memory_order_relaxed);
+    vector<thread> threads;
+    threads.reserve((size_t)T);
+    for (int t = 1; t < T; ++t) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : threads) th.join();
 }
 
 /**
  * @brief Main entry point for the parallel divisibility testing prime finder with delayed output
  * 
  * Algorithm:
- * 1. Load configuration (thread count and limit)
- * 2. Iterate sequentially through numbers from 2 to limit
- * 3. For each number, spawn T threads to test divisibility in parallel
+ * 1. Load configuration (thread count and search window), then apply command-line overrides
+ * 2. Iterate sequentially through numbers from lo to limit
+ * 3. For each number, run one round of the T-thread pool to test divisibility in parallel
  * 4. Collect all primes in a vector
  * 5. Sort the collected primes (ensures ordered output)
  * 6. Output all primes in a batch at the end
@@ -176,37 +1613,100 @@ bool is_prime_parallel(long long n, int T) {
  * - Memory pre-allocation using prime number theorem estimate (n/ln(n))
  * 
  * Performance considerations:
- * - High thread creation overhead (T threads spawned per number tested)
+ * - Per-number round overhead (the T threads are created once): an epoch bump that
+ *   spinning workers see directly or parked ones get through a futex wake, then a
+ *   wait for the pending count to reach zero; numbers below fanout_min run inline
  * - Memory usage grows with number of primes found
  * - Sorting overhead at the end (though typically small)
  * - Best for scenarios where individual numbers are very large
  * 
  * @return 0 on successful completion
  */
-int main() {
+int main(int argc, char** argv) {
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
     Config cfg = load_config();
+    apply_cli(cfg, argc, argv);
     cout << "[START] " << now_str() << "\n";
 
-    const long long nmax = cfg.limit;
+    const u128 nmin = cfg.lo;
+    const u128 nmax = cfg.limit;
     const int T = max(1, cfg.threads);
 
-    vector<long long> primes;
-    // crude upper bound to reduce realloc (n/log n)
-    if (nmax >= 3) {
-        primes.reserve((size_t)(nmax / log((long double)max(3LL, nmax))));
+    if (cfg.bench && cfg.engine == "divtest") {
+        // Benchmark mode: time both divisor schedules over the window instead of listing primes
+        const vector<TrialDivisor> divisors = make_trial_divisors(sieving_primes((long long)nmax));
+        WorkerPool pool(T);
+        benchmark_schedules((long long)nmin, (long long)nmax, pool, divisors, cfg.poll);
+        cout << "[END] " << now_str() << "\n";
+        return 0;
     }
 
-    for (long long n = 2; n <= nmax; ++n) {
-        if (is_prime_parallel(n, T)) primes.push_back(n);
+    vector<u128> primes;
+    // crude estimate to reduce realloc (window width / log n)
+    if (nmax >= nmin) {
+        primes.reserve((size_t)((long double)(nmax - nmin + 1) / log((long double)max<u128>(3, nmax))) + 1);
+    }
+
+    // engine=factor: Miller–Rabin for primality, plus the factorization of each composite
+    const bool use_factor = (cfg.engine == "factor");
+    vector<pair<long long, vector<uint64_t>>> factored;
+
+    if (cfg.engine == "sieve") {
+        // Cooperative sieve: threads split the sieving primes of each segment
+        SieveContext ctx;
+        ctx.primes = sieving_primes((long long)nmax);  // normalize_config() keeps sieve windows below 2^63
+        ctx.presieve = build_presieve_pattern();
+        ctx.segment_bytes = choose_segment_bytes(cfg.segment_kb, detect_cache_sizes());
+        sieve_cooperative((long long)nmin, (long long)nmax, T, ctx, [&](const WheelBitmap& segment) {
+            segment.for_each([&](long long n) { primes.push_back(n); });
+        });
+    } else {
+        const bool use_mr = (cfg.engine == "mr") || use_factor;
+        const bool use_bpsw = (cfg.engine == "bpsw");
+        const vector<TrialDivisor> divisors =
+            (cfg.engine == "divtest") ? make_trial_divisors(sieving_primes((long long)nmax)) : vector<TrialDivisor>();
+        WorkerPool pool((cfg.engine == "divtest" || use_factor) ? T : 1);
+        // Below fanout_min a round trip costs more than the test, so those n run inline
+        DivtestSchedule sched;
+        sched.blocked = (cfg.schedule == "block");
+        sched.poll = cfg.poll;
+        if (cfg.engine == "divtest") {
+            sched.fanout_min = (cfg.fanout_min > 0) ? cfg.fanout_min : calibrate_fanout(pool, divisors, cfg.batch, sched);
+            cerr << "[FANOUT] min_n=" << (sched.fanout_min == LLONG_MAX ? string("never") : to_string(sched.fanout_min))
+                 << (cfg.fanout_min > 0 ? " (configured)" : " (measured)") << " threads=" << T << "\n";
+        }
+        if (cfg.engine == "divtest" && cfg.batch > 1) {
+            // One pool round per cfg.batch consecutive numbers
+            bool prime[kMaxBatch];
+            for (long long lo = (long long)nmin; lo <= (long long)nmax; lo += cfg.batch) {
+                const int K = (int)min<long long>(cfg.batch, (long long)nmax - lo + 1);
+                is_prime_batch(lo, K, pool, divisors, sched, prime);
+                for (int c = 0; c < K; ++c) {
+                    if (prime[c]) primes.push_back(lo + c);
+                }
+                if ((long long)nmax - lo < cfg.batch) break;  // Keep lo from overflowing near 2^63
+            }
+        } else {
+            for (u128 n = nmin; n <= nmax; ++n) {
+                const bool prime = use_bpsw ? is_prime_bpsw(n)
+                                 : use_mr ? is_prime_mr((long long)n)
+                                          : is_prime_parallel((long long)n, pool, divisors, sched);
+                if (prime) primes.push_back(n);
+                else if (use_factor) factored.emplace_back((long long)n, factorize((long long)n, pool));
+                if (n == nmax) break;  // Keep ++n from overflowing when nmax is the largest u128
+            }
+        }
     }
 
     sort(primes.begin(), primes.end());
     cout << "[RESULTS] total=" << primes.size() << "\n";
     for (auto n : primes) {
-        cout << "[PRIME] n=" << n << "\n";
+        cout << "[PRIME] n=" << to_string_u128(n) << "\n";
+    }
+    for (auto& f : factored) {
+        cout << "[FACTOR] n=" << f.first << " factors=" << format_factors(f.second) << "\n";
     }
 
     cout << "[END] " << now_str() << "\n";